@@ -208,11 +208,9 @@ void UserControlledClient::CreateTestWorld()
 
             const Block *block = world->GetBlock(pos);
             std::shared_ptr<Blockstate> previous_blockstate;
-            unsigned char previous_model_id;
             if (block != nullptr)
             {
                 previous_blockstate = block->GetBlockstate();
-                previous_model_id = block->GetModelId();
             }
             else
             {
@@ -221,7 +219,6 @@ void UserControlledClient::CreateTestWorld()
 #else
                 previous_blockstate = AssetsManager::getInstance().Blockstates().at(0);
 #endif
-                previous_model_id = 0;
             }
 #if PROTOCOL_VERSION < 347
             world->SetBlock(pos, 18, 0);
@@ -239,7 +236,6 @@ void UserControlledClient::CreateTestWorld()
             if (block != nullptr)
             {
                 previous_blockstate = block->GetBlockstate();
-                previous_model_id = block->GetModelId();
             }
             else
             {
@@ -248,7 +244,6 @@ void UserControlledClient::CreateTestWorld()
 #else
                 previous_blockstate = AssetsManager::getInstance().Blockstates().at(0);
 #endif
-                previous_model_id = 0;
             }
 
 #if PROTOCOL_VERSION < 347
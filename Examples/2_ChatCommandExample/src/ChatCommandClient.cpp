@@ -217,36 +217,30 @@ void ChatCommandClient::CheckPerimeter(const Position &pos, const float radius,
 {
     std::vector<Position> found_positions;
 
-    Position current_position;
-    for (int y = -radius - 1; y < radius + 1; ++y)
+    const int int_radius = (int)std::ceil(radius);
+    const Position box_size(int_radius, int_radius, int_radius);
+
     {
-        current_position.y = pos.y + y;
-        for (int x = -radius - 1; x < radius + 1; ++x)
-        {
-            current_position.x = pos.x + x;
-            for (int z = -radius - 1; z < radius + 1; ++z)
-            {
-                current_position.z = pos.z + z;
+        std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
 
-                if (x * x + y * y + z * z > radius * radius)
+        world->ForEachBlockInBox(pos - box_size, pos + box_size, [&](const Position& current_position, const Block& block)
+            {
+                const Position offset = current_position - pos;
+                if (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z > radius * radius)
                 {
-                    continue;
+                    return;
                 }
 
-                std::lock_guard<std::mutex> world_guard(world->GetMutex());
-
-                const Block *block = world->GetBlock(current_position);
-
-                if (!block || !block->GetBlockstate()->IsAir())
+                if (!block.GetBlockstate()->IsAir())
                 {
-                    continue;
+                    return;
                 }
 
                 Position adjacent_position = current_position;
                 adjacent_position.y -= 1;
 
                 const Block *adjacent_block = world->GetBlock(adjacent_position);
-                
+
                 if (!adjacent_block ||
                     adjacent_block->GetBlockstate()->IsFluid() ||
                     !adjacent_block->GetBlockstate()->IsSolid() ||
@@ -254,7 +248,7 @@ void ChatCommandClient::CheckPerimeter(const Position &pos, const float radius,
                     adjacent_block->GetBlockstate()->GetName() == "minecraft:bedrock" ||
                     adjacent_block->GetBlockstate()->GetName() == "minecraft:barrier")
                 {
-                    continue;
+                    return;
                 }
 
                 adjacent_position.y += 2;
@@ -265,17 +259,16 @@ void ChatCommandClient::CheckPerimeter(const Position &pos, const float radius,
                     (adjacent_block->GetBlockstate()->IsSolid() ||
                     adjacent_block->GetBlockstate()->IsFluid()))
                 {
-                    continue;
+                    return;
                 }
 
                 if (check_lighting && world->GetBlockLight(current_position) > 7)
                 {
-                    continue;
+                    return;
                 }
 
                 found_positions.push_back(current_position);
-            }
-        }
+            });
     }
 
     std::ofstream output_file("perimeter_check_" + std::to_string(pos.x) + "_" + std::to_string(pos.y) + "_" + std::to_string(pos.z) + "_radius_" + std::to_string(radius) + ".txt", std::ios::out);
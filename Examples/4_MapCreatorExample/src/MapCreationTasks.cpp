@@ -17,6 +17,7 @@
 #include <iostream>
 #include <fstream>
 #include <unordered_set>
+#include <random>
 
 using namespace Botcraft;
 using namespace ProtocolCraft;
@@ -30,31 +31,28 @@ Status GetAllChestsAround(BehaviourClient& c)
 
     const Position player_position(local_player->GetX(), local_player->GetY(), local_player->GetZ());
 
-    Position checked_position;
     {
-        std::lock_guard<std::mutex> world_guard(world->GetMutex());
-        const Block* block;
-        const std::map<std::pair<int, int>, std::shared_ptr<Chunk> >& all_chunks = world->GetAllChunks();
+        std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
+        const ChunkMap& all_chunks = world->GetAllChunks();
 
-        for (auto it = all_chunks.begin(); it != all_chunks.end(); ++it)
+        if (!all_chunks.empty())
         {
-            for (int x = 0; x < CHUNK_WIDTH; ++x)
+            // Get the box containing all the loaded chunks
+            Position min_pos(all_chunks.begin()->first.first, world->GetMinY(), all_chunks.begin()->first.second);
+            Position max_pos(min_pos.x, world->GetMinY() + world->GetHeight() - 1, min_pos.z);
+            for (auto it = all_chunks.begin(); it != all_chunks.end(); ++it)
             {
-                checked_position.x = it->first.first * CHUNK_WIDTH + x;
-                for (int y = 0; y < world->GetHeight(); ++y)
-                {
-                    checked_position.y = y + world->GetMinY();
-                    for (int z = 0; z < CHUNK_WIDTH; ++z)
-                    {
-                        checked_position.z = it->first.second * CHUNK_WIDTH + z;
-                        block = world->GetBlock(checked_position);
-                        if (block && block->GetBlockstate()->GetName() == "minecraft:chest")
-                        {
-                            chests_pos.push_back(checked_position);
-                        }
-                    }
-                }
+                min_pos.x = std::min(min_pos.x, it->first.first);
+                min_pos.z = std::min(min_pos.z, it->first.second);
+                max_pos.x = std::max(max_pos.x, it->first.first);
+                max_pos.z = std::max(max_pos.z, it->first.second);
             }
+            min_pos.x *= CHUNK_WIDTH;
+            min_pos.z *= CHUNK_WIDTH;
+            max_pos.x = max_pos.x * CHUNK_WIDTH + CHUNK_WIDTH - 1;
+            max_pos.z = max_pos.z * CHUNK_WIDTH + CHUNK_WIDTH - 1;
+
+            chests_pos = world->FindBlocks(min_pos, max_pos, { "minecraft:chest" });
         }
     }
 
@@ -429,7 +427,7 @@ Status FindNextTask(BehaviourClient& c)
             const std::string& target_name = palette.at(target_palette);
             std::shared_ptr<Blockstate> blockstate;
             {
-                std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                 const Block* block = world->GetBlock(pos);
 
                 if (!block)
@@ -453,7 +451,7 @@ Status FindNextTask(BehaviourClient& c)
             {
                 for (int i = 0; i < neighbour_offsets.size(); ++i)
                 {
-                    std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                    std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                     const Block* neighbour_block = world->GetBlock(pos + neighbour_offsets[i]);
 
                     if (neighbour_block && !neighbour_block->GetBlockstate()->IsAir())
@@ -471,7 +469,7 @@ Status FindNextTask(BehaviourClient& c)
             {
                 for (int i = 0; i < neighbour_offsets.size(); ++i)
                 {
-                    std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                    std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                     const Block* neighbour_block = world->GetBlock(pos + neighbour_offsets[i]);
 
                     if (neighbour_block && !neighbour_block->GetBlockstate()->IsAir())
@@ -618,6 +616,18 @@ Status CheckCompletion(BehaviourClient& c)
     blackboard.Set("CheckCompletion.print_errors", false);
     blackboard.Set("CheckCompletion.full_check", false);
 
+    // Get all the blocks of the structure area in one pass,
+    // positions that are not loaded will stay nullptr
+    std::vector<std::vector<std::vector<const Blockstate*> > > world_blockstates(end.x - start.x + 1,
+        std::vector<std::vector<const Blockstate*> >(end.y - start.y + 1, std::vector<const Blockstate*>(end.z - start.z + 1, nullptr)));
+    {
+        std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
+        world->ForEachBlockInBox(start, end, [&](const Position& pos, const Block& block)
+            {
+                world_blockstates[pos.x - start.x][pos.y - start.y][pos.z - start.z] = block.GetBlockstate().get();
+            });
+    }
+
     for (int x = start.x; x <= end.x; ++x)
     {
         world_pos.x = x;
@@ -632,28 +642,23 @@ Status CheckCompletion(BehaviourClient& c)
                 target_pos.z = z - start.z;
 
                 const short target_id = target[target_pos.x][target_pos.y][target_pos.z];
-                std::shared_ptr<Blockstate> blockstate;
-                {
-                    std::lock_guard<std::mutex> world_guard(world->GetMutex());
-                    const Block* block = world->GetBlock(world_pos);
+                const Blockstate* blockstate = world_blockstates[target_pos.x][target_pos.y][target_pos.z];
 
-                    if (!block)
+                if (!blockstate)
+                {
+                    if (target_id != -1)
                     {
-                        if (target_id != -1)
+                        if (!full_check)
                         {
-                            if (!full_check)
-                            {
-                                return Status::Failure;
-                            }
-                            missing_blocks++;
-                            if (print_details && missing_blocks < 100) // Don't print more than 100 missing blocks
-                            {
-                                std::cout << "Missing " << palette.at(target_id) << " in " << world_pos << std::endl;
-                            }
+                            return Status::Failure;
+                        }
+                        missing_blocks++;
+                        if (print_details && missing_blocks < 100) // Don't print more than 100 missing blocks
+                        {
+                            std::cout << "Missing " << palette.at(target_id) << " in " << world_pos << std::endl;
                         }
-                        continue;
                     }
-                    blockstate = block->GetBlockstate();
+                    continue;
                 }
 
                 if (target_id == -1)
@@ -24,7 +24,19 @@ namespace Botcraft
 #else
         const std::map<int, std::shared_ptr<Blockstate> >& Blockstates() const;
 #endif
-        
+
+        // Get a blockstate from its global id (id << 4 | metadata before 1.13),
+        // the default blockstate is returned for unknown ids.
+        // This is an indexed load in a contiguous table, prefer
+        // it to Blockstates() when the id is known
+        const std::shared_ptr<Blockstate>& GetBlockstate(const unsigned int global_id) const
+        {
+            return global_id < flattened_blockstates.size() ? flattened_blockstates[global_id] : default_blockstate;
+        }
+#if PROTOCOL_VERSION < 347
+        const std::shared_ptr<Blockstate>& GetBlockstate(const int id, const unsigned char metadata) const;
+#endif
+
 #if PROTOCOL_VERSION < 358
         const std::map<unsigned char, std::shared_ptr<Biome> >& Biomes() const;
         const std::shared_ptr<Biome> GetBiome(const unsigned char id);
@@ -43,6 +55,8 @@ namespace Botcraft
         AssetsManager();
 
         void LoadBlocksFile();
+        // Build the contiguous table indexed by global id from the blockstates map
+        void FlattenBlockstates();
         void LoadBiomesFile();
         void LoadItemsFile();
         void ClearCaches();
@@ -53,6 +67,10 @@ namespace Botcraft
 #else
         std::map<int, std::shared_ptr<Blockstate> > blockstates;
 #endif
+        // Blockstates indexed by global id
+        std::vector<std::shared_ptr<Blockstate> > flattened_blockstates;
+        std::shared_ptr<Blockstate> default_blockstate;
+
 #if PROTOCOL_VERSION < 358
         std::map<unsigned char, std::shared_ptr<Biome> > biomes;
 #else
@@ -63,6 +63,8 @@ namespace Botcraft
 
     protected:
         std::shared_ptr<World> world;
+        // Used instead of world async handler for shared worlds
+        std::shared_ptr<ProtocolCraft::Handler> world_handler;
         std::shared_ptr<EntityManager> entity_manager;
         std::shared_ptr<InventoryManager> inventory_manager;
 #if USE_GUI
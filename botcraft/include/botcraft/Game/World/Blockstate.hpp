@@ -1,13 +1,14 @@
 #pragma once
 
 #include <string>
-#include <random>
+#include <vector>
 #include <map>
 
 #include <nlohmann/json.hpp>
 
 #include "botcraft/Game/Model.hpp"
 #include "botcraft/Game/Enums.hpp"
+#include "botcraft/Game/Vector3.hpp"
 
 namespace Botcraft
 {
@@ -41,7 +42,10 @@ namespace Botcraft
         const unsigned char GetMetadata() const;
 #endif
         const Model &GetModel(const unsigned char index) const;
-        const unsigned char GetRandomModelId();
+        // Get the index of the model used for a block at pos.
+        // Variants are chosen deterministically from the position,
+        // so the same block always gets the same model
+        const unsigned char GetModelId(const Position& pos) const;
         const int GetNumModels() const;
         const std::string &GetName() const;
 
@@ -72,8 +76,6 @@ namespace Botcraft
         std::vector<int> models_weights;
         int weights_sum;
 
-        std::mt19937 random_generator;
-
         unsigned int id;
 #if PROTOCOL_VERSION < 347
         unsigned char metadata;
@@ -3,6 +3,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <array>
 
 #include "botcraft/Game/World/Block.hpp"
 #include "botcraft/Game/Enums.hpp"
@@ -11,29 +12,59 @@
 
 namespace Botcraft
 {
-    struct Section;
+    class Section;
 
     //We assume that a chunk is 16*256*16 in versions before 1.18 and 16*N*16 after
     //And a section is 16*16*16
     static const int CHUNK_WIDTH = 16;
+    // CHUNK_WIDTH == 1 << CHUNK_WIDTH_BITS, to get chunk
+    // coordinates from block ones with shifts and masks
+    static const int CHUNK_WIDTH_BITS = 4;
     static const int SECTION_HEIGHT = 16;
 
+    // Data stored in the world in addition to the blocks.
+    // Disabled layers are skipped when loading the chunks
+    // and never stored, getters return default values.
+    // Bots that only need the blocks (physics, pathfinding)
+    // can disable them to save memory and loading time
+    struct WorldLayers
+    {
+        bool light = true;
+        bool biomes = true;
+        bool block_entities = true;
+        // If false, blocks with multiple models (with random
+        // variations) always use the first one for collisions
+        bool model_variants = true;
+    };
+
+    // Columns height tracked for each chunk
+    enum class Heightmap
+    {
+        // Highest block that is solid or contains a fluid
+        MotionBlocking = 0,
+        // Highest non air block
+        WorldSurface = 1
+    };
+
     class Chunk
     {
     public:
 #if PROTOCOL_VERSION < 719
-        Chunk(const Dimension &dim = Dimension::Overworld);
+        Chunk(const Dimension &dim = Dimension::Overworld, const WorldLayers& layers_ = WorldLayers());
 #elif PROTOCOL_VERSION < 757
-        Chunk(const std::string& dim = "minecraft:overworld");
+        Chunk(const std::string& dim = "minecraft:overworld", const WorldLayers& layers_ = WorldLayers());
 #else
-        Chunk(const int min_y_, const unsigned int height_, const std::string& dim = "minecraft:overworld");
+        Chunk(const int min_y_, const unsigned int height_, const std::string& dim = "minecraft:overworld", const WorldLayers& layers_ = WorldLayers());
 #endif
+        // Sections and block entities are shared with c, they are
+        // only copied when one of the two chunks modifies them
         Chunk(const Chunk& c);
 
         static const Position BlockCoordsToChunkCoords(const Position& pos);
 
         const int GetMinY() const;
         const int GetHeight() const;
+        const WorldLayers& GetLayers() const;
 
 #if USE_GUI
         const bool GetModifiedSinceLastRender() const;
@@ -50,35 +81,106 @@ namespace Botcraft
         void LoadChunkData(const std::vector<unsigned char>& data);
 #endif
 #if PROTOCOL_VERSION < 757
-        void LoadChunkBlockEntitiesData(const std::vector<ProtocolCraft::NBT>& block_entities);
+        void LoadChunkBlockEntitiesData(const std::vector<ProtocolCraft::NBT>& new_block_entities);
 #else
-        void LoadChunkBlockEntitiesData(const std::vector<ProtocolCraft::BlockEntityInfo>& block_entities);
+        void LoadChunkBlockEntitiesData(const std::vector<ProtocolCraft::BlockEntityInfo>& new_block_entities);
 #endif
+#if PROTOCOL_VERSION < 757
         void SetBlockEntityData(const Position& pos, const ProtocolCraft::NBT& block_entity);
+#else
+        // If type is -1, the type of the previous block entity at pos is kept
+        void SetBlockEntityData(const Position& pos, const ProtocolCraft::NBT& block_entity, const int type = -1);
+#endif
         void RemoveBlockEntityData(const Position& pos);
-        const std::shared_ptr<ProtocolCraft::NBT> GetBlockEntityData(const Position& pos) const;
+        // Block entities are stored as raw NBT data, the
+        // returned NBT is decoded each time this is called
+        const std::shared_ptr<const ProtocolCraft::NBT> GetBlockEntityData(const Position& pos) const;
+#if PROTOCOL_VERSION < 757
+        // Get the positions of the block entities with a given id (for
+        // example "minecraft:chest"), or of all of them if type is empty
+        std::vector<Position> GetBlockEntitiesPositions(const std::string& type = "") const;
+#else
+        // Get the positions of the block entities with a given
+        // type id, or of all of them if type is -1
+        std::vector<Position> GetBlockEntitiesPositions(const int type = -1) const;
+#endif
 
         const Block *GetBlock(const Position &pos) const;
 #if PROTOCOL_VERSION < 347
-        void SetBlock(const Position &pos, const unsigned int id, unsigned char metadata, const int model_id = -1);
+        void SetBlock(const Position &pos, const unsigned int id, unsigned char metadata);
 #else
-        void SetBlock(const Position &pos, const unsigned int id, const int model_id = -1);
+        void SetBlock(const Position &pos, const unsigned int id);
 #endif
         void SetBlock(const Position& pos, const Block* block);
+        // Same as GetBlock(pos)->GetBlockstate()->IsSolid() (or IsFluid), but
+        // only reading the section occupancy, false if there is no block
+        const bool IsSolid(const Position& pos) const;
+        const bool IsFluid(const Position& pos) const;
+        // Set several blocks of section y at once. blocks contains the
+        // index of each block in the section and its new value. If not
+        // nullptr, blockstates gets the old and new blockstate of each
+        // block, in the same order (nullptr for air in a missing section)
+        void SetSectionBlocks(const int y, const std::vector<std::pair<int, Block> >& blocks,
+            std::vector<std::pair<const Blockstate*, const Blockstate*> >* blockstates = nullptr);
+
+        // Get the y of the highest block of the column
+        // x, z for a heightmap, min_y - 1 if there is none
+        const int GetHighestBlock(const int x, const int z, const Heightmap heightmap) const;
+        // Compute the heightmaps from the blocks
+        void ComputeHeightmaps();
+#if PROTOCOL_VERSION > 442
+        // Load the heightmaps sent with the chunk data. Only WORLD_SURFACE
+        // is used, MOTION_BLOCKING is computed from the blocks as botcraft
+        // solid blocks are not exactly the same as the vanilla ones
+        void LoadHeightmaps(const ProtocolCraft::NBT& heightmaps_data);
+#endif
 
         const unsigned char GetBlockLight(const Position &pos) const;
         void SetBlockLight(const Position &pos, const unsigned char v);
         const unsigned char GetSkyLight(const Position &pos) const;
         void SetSkyLight(const Position &pos, const unsigned char v);
+        // Replace the light of section y with Section::LIGHT_DATA_SIZE bytes
+        // in the network format, or set it to 0 if data is nullptr
+        void SetSectionBlockLight(const int y, const char* data);
+        void SetSectionSkyLight(const int y, const char* data);
+#if PROTOCOL_VERSION > 404
+        // Load the light of a light packet. The first and last arrays
+        // (below and above the chunk) are ignored
+#if PROTOCOL_VERSION < 755
+        void LoadLightData(const int light_mask, const int empty_light_mask,
+            const std::vector<std::vector<char> >& data, const bool sky);
+#else
+        void LoadLightData(const std::vector<unsigned long long int>& light_mask, const std::vector<unsigned long long int>& empty_light_mask,
+            const std::vector<std::vector<char> >& data, const bool sky);
+#endif
+#endif
 #if PROTOCOL_VERSION < 719
         const Dimension GetDimension() const;
 #else
         const std::string& GetDimension() const;
 #endif
-        const std::map<Position, std::shared_ptr<ProtocolCraft::NBT> >& GetBlockEntitiesData() const;
 
         const bool HasSection(const int y) const;
         void AddSection(const int y);
+        // A section is never modified once shared between chunks,
+        // so if two copies of a chunk return the same pointer
+        // for a section, it hasn't changed between the two
+        const std::shared_ptr<const Section> GetSection(const int y) const;
+        // Replace the sections by their interned version (see Section::Intern)
+        void InternSections();
+
+        // Write the sections, biomes and block entities of the chunk in
+        // a compact binary format, the dimension is not included
+        void Serialize(ProtocolCraft::WriteContainer& container) const;
+        // Create a chunk from data written by Serialize. Throw
+        // a std::runtime_error if the data are not valid
+#if PROTOCOL_VERSION < 719
+        static std::shared_ptr<Chunk> Deserialize(ProtocolCraft::ReadIterator& iter, size_t& length,
+            const Dimension& dim, const WorldLayers& layers_ = WorldLayers());
+#else
+        static std::shared_ptr<Chunk> Deserialize(ProtocolCraft::ReadIterator& iter, size_t& length,
+            const std::string& dim, const WorldLayers& layers_ = WorldLayers());
+#endif
 
 #if PROTOCOL_VERSION < 358
         const unsigned char GetBiome(const int x, const int z) const;
@@ -93,8 +195,28 @@ namespace Botcraft
 		void SetBiome(const int x, const int y, const int z, const int new_biome);
 		void SetBiome(const int i, const int new_biome);
 #endif
-        void UpdateNeighbour(const std::shared_ptr<Chunk> neighbour, const Orientation direction);
-        
+    private:
+        // Get section y, ready to be modified. Makes a copy of
+        // the section first if it's shared with another chunk
+        Section* GetMutableSection(const int y);
+        // Replace all the blocks of section y. indices are the NUM_BLOCKS
+        // indices of the network data, in palette, or blockstate ids if
+        // palette is nullptr (global palette). indices are modified
+        void LoadSectionBlocks(const int y, const std::vector<int>* palette, unsigned int* indices);
+        // Update the heightmaps after the block at pos changed to blockstate
+        void UpdateHeightmaps(const Position& pos, const Blockstate* blockstate);
+        void ComputeHeightmap(const Heightmap heightmap);
+
+        // Get the block entities ready to be modified, making
+        // a copy first if they are shared with another chunk
+        struct BlockEntities;
+        BlockEntities* GetMutableBlockEntities();
+#if PROTOCOL_VERSION < 757
+        void AddBlockEntity(const Position& pos, const ProtocolCraft::NBT& block_entity);
+#else
+        void AddBlockEntity(const Position& pos, const ProtocolCraft::NBT& block_entity, const int type);
+#endif
+
     private:
         std::vector<std::shared_ptr<Section> > sections;
 #if PROTOCOL_VERSION < 358
@@ -102,7 +224,45 @@ namespace Botcraft
 #else
         std::vector<int> biomes;
 #endif
-        std::map<Position, std::shared_ptr<ProtocolCraft::NBT> > block_entities_data;
+        struct BlockEntities
+        {
+            struct Entry
+            {
+                // x | z << 4 | (y - min_y) << 8
+                int index;
+#if PROTOCOL_VERSION < 757
+                // Position of the block entity id in types, -1 if none
+#else
+                // Block entity type id sent by the server, -1 if unknown
+#endif
+                int type;
+                // Position of the NBT data in data
+                size_t offset;
+                size_t size;
+            };
+            // Sorted by index
+            std::vector<Entry> entries;
+            // NBT data of the entries in the network format, one
+            // after the other. May contain unused data after a
+            // block entity is removed or replaced
+            std::vector<unsigned char> data;
+            // Size of the unused data
+            size_t unused_size = 0;
+#if PROTOCOL_VERSION < 757
+            std::vector<std::string> types;
+
+            // Get the position of type in types, adding it if
+            // necessary, -1 if type is empty
+            const int FindOrAddType(const std::string& type);
+#endif
+            // Remove the unused data
+            void Compact();
+        };
+        // Shared between chunk copies until one of them modifies it, nullptr if empty
+        std::shared_ptr<BlockEntities> block_entities;
+        // For each heightmap and column, height of the highest block
+        // above min_y (0 if none), the same values as vanilla ones
+        std::array<std::array<short, CHUNK_WIDTH * CHUNK_WIDTH>, 2> heightmaps;
 #if PROTOCOL_VERSION < 719
         Dimension dimension;
 #else
@@ -115,6 +275,7 @@ namespace Botcraft
         int min_y;
         int height;
 #endif
+        WorldLayers layers;
 #if USE_GUI
         bool modified_since_last_rendered;
 #endif
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <iterator>
+
+namespace Botcraft
+{
+    class Chunk;
+
+    // Hash map from chunk coordinates to chunks. Entries are stored
+    // in a single flat array with open addressing and linear probing,
+    // so a lookup is a multiplication and (most of the time) one
+    // memory access. The interface is a subset of std::map's one
+    class ChunkMap
+    {
+    public:
+        typedef std::pair<int, int> key_type;
+        typedef std::pair<key_type, std::shared_ptr<Chunk> > value_type;
+
+        class const_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef ChunkMap::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const value_type* pointer;
+            typedef const value_type& reference;
+
+            const_iterator(const std::vector<value_type>* slots_, const size_t index_)
+            {
+                slots = slots_;
+                index = index_;
+                SkipEmpty();
+            }
+
+            reference operator*() const
+            {
+                return (*slots)[index];
+            }
+
+            pointer operator->() const
+            {
+                return &(*slots)[index];
+            }
+
+            const_iterator& operator++()
+            {
+                index++;
+                SkipEmpty();
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator output = *this;
+                ++(*this);
+                return output;
+            }
+
+            bool operator==(const const_iterator& other) const
+            {
+                return index == other.index;
+            }
+
+            bool operator!=(const const_iterator& other) const
+            {
+                return index != other.index;
+            }
+
+        private:
+            void SkipEmpty()
+            {
+                while (index < slots->size() && (*slots)[index].second == nullptr)
+                {
+                    index++;
+                }
+            }
+
+        private:
+            friend class ChunkMap;
+            const std::vector<value_type>* slots;
+            size_t index;
+        };
+        typedef const_iterator iterator;
+
+        ChunkMap();
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        const_iterator find(const key_type& key) const;
+
+        // Get the chunk at x, z or nullptr if not present
+        Chunk* Get(const int x, const int z) const
+        {
+            if (num_elements == 0)
+            {
+                return nullptr;
+            }
+            const size_t slot = FindSlot(x, z);
+            return slots[slot].second.get();
+        }
+
+        // chunk must not be nullptr
+        void insert_or_assign(const key_type& key, const std::shared_ptr<Chunk>& chunk);
+        void erase(const const_iterator& it);
+        size_t erase(const key_type& key);
+        void clear();
+
+        size_t size() const;
+        bool empty() const;
+
+    private:
+        // Index of the slot containing x, z, or of the
+        // empty slot where it should be inserted
+        size_t FindSlot(const int x, const int z) const
+        {
+            size_t slot = Hash(x, z);
+            while (slots[slot].second != nullptr &&
+                (slots[slot].first.first != x || slots[slot].first.second != z))
+            {
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+
+        size_t Hash(const int x, const int z) const
+        {
+            // Fibonacci hashing of the packed coordinates, keep the high bits
+            const unsigned long long int packed = (static_cast<unsigned long long int>(static_cast<unsigned int>(x)) << 32) | static_cast<unsigned int>(z);
+            return static_cast<size_t>((packed * 0x9E3779B97F4A7C15ULL) >> (64 - capacity_bits));
+        }
+
+        void Rehash(const unsigned char new_capacity_bits);
+
+    private:
+        // Empty slots have a nullptr chunk
+        std::vector<value_type> slots;
+        size_t num_elements;
+        unsigned char capacity_bits;
+        size_t mask;
+    };
+} // Botcraft
@@ -1,27 +1,131 @@
 #pragma once
 
 #include <vector>
-#include <map>
+#include <deque>
 #include <memory>
+#include <array>
 
 #include "botcraft/Game/World/Chunk.hpp"
 
+#include "protocolCraft/BinaryReadWrite.hpp"
+
 namespace Botcraft
 {
-    struct Section
+    struct SectionInternStats
     {
-        Section(const bool has_sky_light)
-        {
-            // +2 because we also store the neighbour section blocks
-            data_blocks = std::vector<Block>((CHUNK_WIDTH + 2) * (CHUNK_WIDTH + 2) * SECTION_HEIGHT);
-            block_light = std::vector<unsigned char>(CHUNK_WIDTH * CHUNK_WIDTH * SECTION_HEIGHT);
-            if (has_sky_light)
-            {
-                sky_light = std::vector<unsigned char>(CHUNK_WIDTH * CHUNK_WIDTH * SECTION_HEIGHT);
-            }
-        }
-        std::vector<Block> data_blocks;
-        std::vector<unsigned char> block_light;
-        std::vector<unsigned char> sky_light;
+        // Number of sections given to Section::Intern
+        size_t lookups = 0;
+        // Number of times an identical section was already interned
+        size_t hits = 0;
+        // Number of distinct sections currently in the intern table
+        size_t interned = 0;
+    };
+
+    // Blocks are stored the same way they are sent by the server:
+    // a palette of the different blocks present in the section, and
+    // a bit-packed array of indices into this palette, one per block.
+    // The indices are re-packed with more bits when the palette grows.
+    class Section
+    {
+    public:
+        Section(const bool has_sky_light);
+
+        // Number of blocks stored in a section
+        static const int NUM_BLOCKS = CHUNK_WIDTH * CHUNK_WIDTH * SECTION_HEIGHT;
+        // Size in bytes of the light arrays, 4 bits per block
+        static const int LIGHT_DATA_SIZE = NUM_BLOCKS / 2;
+
+        // Get a pointer to the block at index. The pointer
+        // is invalidated by the next SetBlock on this section
+        const Block* GetBlock(const int index) const;
+        void SetBlock(const int index, const Block& block);
+        // Replace all the blocks at once. palette_indices contains NUM_BLOCKS
+        // indices in new_palette, in the same order as the network data
+        void LoadPalettedData(std::deque<Block>&& new_palette, const unsigned int* palette_indices);
+
+        const size_t GetPaletteSize() const;
+        const unsigned char GetBitsPerEntry() const;
+
+        // Occupancy of the section, kept up to date with the blocks.
+        // Bit index % 64 of word index / 64 of the masks is set if
+        // the block at index is solid (or fluid), so whole rows of
+        // blocks can be tested without looking at the blocks
+        const bool IsSolid(const int index) const;
+        const bool IsFluid(const int index) const;
+        const std::array<unsigned long long int, NUM_BLOCKS / 64>& GetSolidMask() const;
+        const std::array<unsigned long long int, NUM_BLOCKS / 64>& GetFluidMask() const;
+        // Number of blocks that are not air, 0 if there is only air
+        const int GetNonAirCount() const;
+
+        // Blocks that can be found in this section. It may also
+        // contain some blocks that are not used anymore
+        const std::deque<Block>& GetPalette() const;
+        // Get the index in the palette of the block at index
+        const unsigned int GetPaletteIndex(const int index) const;
+
+        const unsigned char GetBlockLight(const int index) const;
+        void SetBlockLight(const int index, const unsigned char v);
+        const unsigned char GetSkyLight(const int index) const;
+        void SetSkyLight(const int index, const unsigned char v);
+        // Replace the light with LIGHT_DATA_SIZE bytes
+        // using the same format as the network data
+        void SetBlockLightData(const char* data);
+        void SetSkyLightData(const char* data);
+        // Set the light to the same value v for all the blocks
+        void FillBlockLight(const unsigned char v);
+        void FillSkyLight(const unsigned char v);
+
+        // Get the interned section with the same content as section, or
+        // add section to the intern table if there is none. Identical
+        // sections (all air, all stone...) of all the worlds of the process
+        // then share the same memory. The intern table keeps a reference on
+        // the sections, so they are always copied before being modified
+        static std::shared_ptr<Section> Intern(const std::shared_ptr<Section>& section);
+        static const SectionInternStats GetInternStats();
+
+        // Write the palette, the indices and the light in a compact
+        // binary format, that can be loaded back with Deserialize
+        void Serialize(ProtocolCraft::WriteContainer& container) const;
+        // Replace the content of this section by serialized data.
+        // Throw a std::runtime_error if the data are not valid
+        void Deserialize(ProtocolCraft::ReadIterator& iter, size_t& length);
+
+    private:
+        void SetPaletteIndex(const int index, const unsigned int palette_index);
+        // Get the index of block in the palette, add it if not present
+        const unsigned int FindOrAddToPalette(const Block& block);
+        // Remove blocks not used anymore from the palette
+        void CompactPalette();
+        void Repack(const unsigned char new_bits_per_entry);
+        // Rebuild the occupancy from all the blocks
+        void ComputeOccupancy();
+
+        typedef std::array<unsigned char, LIGHT_DATA_SIZE> LightArray;
+        // Get a shared array with all light values equal to v
+        static const std::shared_ptr<LightArray>& GetUniformLight(const unsigned char v);
+        static void SetLightData(std::shared_ptr<LightArray>& light, const char* data);
+        static void SetLight(std::shared_ptr<LightArray>& light, const int index, const unsigned char v);
+        static void SerializeLight(const std::shared_ptr<LightArray>& light, ProtocolCraft::WriteContainer& container);
+        static void DeserializeLight(std::shared_ptr<LightArray>& light, ProtocolCraft::ReadIterator& iter, size_t& length);
+
+        const unsigned long long int GetContentHash() const;
+        const bool HasSameContent(const Section& other) const;
+
+    private:
+        // Light arrays are shared between sections (and section
+        // copies) until modified, uniform ones are never copied
+        std::shared_ptr<LightArray> block_light;
+        std::shared_ptr<LightArray> sky_light;
+
+        std::deque<Block> palette;
+        // Always 0 (single value), 4, 8 or 16 so entries never span across two longs
+        unsigned char bits_per_entry;
+        std::vector<unsigned long long int> data;
+        // Most of the time consecutive SetBlock use the same block
+        unsigned int last_palette_index;
+
+        std::array<unsigned long long int, NUM_BLOCKS / 64> solid_mask;
+        std::array<unsigned long long int, NUM_BLOCKS / 64> fluid_mask;
+        int non_air_count;
     };
-} // Botcraft
\ No newline at end of file
+} // Botcraft
@@ -4,11 +4,18 @@
 #include <array>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 #include <queue>
+#include <set>
+#include <unordered_set>
+#include <functional>
 
 #include "botcraft/Game/Vector3.hpp"
 #include "botcraft/Game/Enums.hpp"
 #include "botcraft/Game/World/Chunk.hpp"
+#include "botcraft/Game/World/ChunkMap.hpp"
 
 #include "protocolCraft/Types/NBT/NBT.hpp"
 #include "protocolCraft/Handler.hpp"
@@ -17,15 +24,47 @@ namespace Botcraft
 {
     class Block;
     class Blockstate;
+    class Section;
     class AsyncHandler;
+    class WorldClientHandler;
+    class RegionCache;
+
+    // A modification of the world, see World::SubscribeToChanges
+    struct WorldChange
+    {
+        enum class Type
+        {
+            // Chunk chunk_x, chunk_z has been added or replaced
+            ChunkLoaded,
+            // Chunk chunk_x, chunk_z has been removed
+            ChunkUnloaded,
+            // All the blocks of the section starting at pos
+            // have been replaced (partial chunk data)
+            SectionReplaced,
+            // The block at pos changed from old_blockstate to new_blockstate
+            BlockChanged
+        };
+
+        Type type;
+        // Version of the world after this change, increasing with each change
+        unsigned long long int version;
+        int chunk_x;
+        int chunk_z;
+        // Only for SectionReplaced and BlockChanged
+        Position pos;
+        // Only for BlockChanged, nullptr for air in a missing section
+        const Blockstate* old_blockstate;
+        const Blockstate* new_blockstate;
+    };
 
     class World : public ProtocolCraft::Handler
     {
     public:
         // if is_shared_ is true, this world
         // can be shared by multiple bot instance, saving memory
-        // when they are in the same area, but slowing things down
-        // if too many share the same instance
+        // when they are in the same area. A chunk is only
+        // decoded once, even if several bots receive it, and
+        // is unloaded when no bot needs it anymore
         //
         // if async_handler_ is true, all packets will be copied
         // and processed on another specific thread instead of
@@ -33,11 +72,29 @@ namespace Botcraft
         // This adds a **lot** of copy but can prevent some timeouts
         // when CPU is too slow to cope with all chunk data sent
         // when loading a dimension
-        World(const bool is_shared_, const bool async_handler_ = false);
+        //
+        // layers_ can be used to disable the storage of the data
+        // that are not needed by the bots (light, biomes...)
+        //
+        // Chunk data packets are decoded into a new chunk without
+        // locking the world, which is then swapped in. If decoding_threads_
+        // is > 0, this decoding is done on that many worker threads
+        // instead of the thread processing the packets. Block updates
+        // received in the meantime are applied once the chunk is swapped in
+        //
+        // if cache_folder_ is not empty, chunks are saved in region files
+        // in this (existing) folder when they are unloaded, and can still
+        // be read with GetCachedChunk after that, even after a restart
+        World(const bool is_shared_, const bool async_handler_ = false, const WorldLayers& layers_ = WorldLayers(), const int decoding_threads_ = 0,
+            const std::string& cache_folder_ = "");
         ~World();
 
-        std::mutex& GetMutex();
+        // Lock it exclusively (lock/unlock, std::lock_guard) to modify
+        // the world. Read-only accesses (GetBlock, GetBiome, Raycast...)
+        // can use a std::shared_lock so multiple readers can run at the same time
+        std::shared_mutex& GetMutex();
         const bool IsShared() const;
+        const WorldLayers& GetLayers() const;
 
         ProtocolCraft::Handler* GetAsyncHandler();
 
@@ -74,28 +131,73 @@ namespace Botcraft
         bool LoadBiomesInChunk(const int x, const int z, const std::vector<int>& biomes);
 #endif
 
-        // Update the neighbour blocks of this chunk and the
-        // one in the specified direction, if direction is 0,0,0
-        // then update all neighbours chunks
+        // Notify the neighbour of this chunk in the specified
+        // direction that it has been modified, if direction
+        // is 0,0,0 then notify all neighbours chunks
+#if USE_GUI
         void UpdateChunk(const int x, const int z, const Position& pos = Position());
+#else
+        // Nothing to notify without rendering
+        void UpdateChunk(const int, const int, const Position& = Position()) {}
+#endif
 
+        // Get a snapshot of a chunk, cheap as sections are
+        // shared with the world chunk until it's modified
         const std::shared_ptr<const Chunk> GetChunkCopy(const int x, const int z);
+        // Same as GetChunkCopy, but if the chunk is not loaded,
+        // get its last known version (in the current dimension)
+        // from the disk cache. Return nullptr if it has never been
+        // seen or if the world has no cache. The world must be
+        // locked during the call (a shared lock is enough)
+        const std::shared_ptr<const Chunk> GetCachedChunk(const int x, const int z);
 
 #if PROTOCOL_VERSION < 347
-        bool SetBlock(const Position &pos, const unsigned int id, unsigned char metadata, const int model_id = -1);
+        bool SetBlock(const Position &pos, const unsigned int id, unsigned char metadata);
 #else
-        bool SetBlock(const Position &pos, const unsigned int id, const int model_id = -1);
+        bool SetBlock(const Position &pos, const unsigned int id);
 #endif
+        /**
+        * Set several blocks at once. Blocks are grouped by section, so each chunk
+        * and section is looked up (and copied if shared) only once, and neighbours
+        * are updated once per chunk. Blocks of chunks being decoded are set once the
+        * chunk is swapped in. The world must be locked exclusively during the call
+        *
+        * @param blocks positions and blockstate ids (as sent by the server, id << 4 | metadata
+        *        before 1.13) of the blocks to set. If a position appears several times,
+        *        the last one wins
+        */
+        void ApplyBlockBatch(const std::vector<std::pair<Position, unsigned int> >& blocks);
         //Get the block at a given position
         const Block* GetBlock(const Position& pos);
         const bool IsLoaded(const Position& pos) const;
+        // Check if the block at pos is solid (or fluid) without looking at it,
+        // false if it's not loaded. The world must be locked during the call
+        // (a shared lock is enough)
+        const bool IsSolid(const Position& pos) const;
+        const bool IsFluid(const Position& pos) const;
+
+        /**
+        * Get the y of the highest block of a column, without looking at the blocks.
+        * The world must be locked during the call (a shared lock is enough)
+        *
+        * @param x, z the column coordinates
+        * @param heightmap MotionBlocking for the highest solid or fluid block (to land on),
+        *        WorldSurface for the highest non air block
+        * @return the y of the highest block, or GetMinY() - 1 if the column is empty or not loaded
+        */
+        const int GetHighestBlock(const int x, const int z, const Heightmap heightmap = Heightmap::MotionBlocking);
 
         const int GetHeight() const;
         const int GetMinY() const;
 
+#if PROTOCOL_VERSION < 757
         bool SetBlockEntityData(const Position &pos, const ProtocolCraft::NBT& data);
+#else
+        // type is the block entity type id, -1 to keep the previous one
+        bool SetBlockEntityData(const Position &pos, const ProtocolCraft::NBT& data, const int type = -1);
+#endif
         // Get the block entity data at a given position
-        std::shared_ptr<ProtocolCraft::NBT> GetBlockEntityData(const Position& pos);
+        std::shared_ptr<const ProtocolCraft::NBT> GetBlockEntityData(const Position& pos);
 
 #if PROTOCOL_VERSION < 358
         bool SetBiome(const int x, const int z, const unsigned char biome);
@@ -132,7 +234,9 @@ namespace Botcraft
 #endif
 
         /**
-        * Perform a raycast in the voxel world and return position, normal and blockstate which are hit
+        * Perform a raycast in the voxel world and return position, normal and blockstate which are hit.
+        * Empty, air only and unloaded sections are crossed without looking at their blocks.
+        * The world must be locked during the call (a shared lock is enough)
         *
         * @param[in] origin the origin of the ray
         * @param[in] direction the direction of the ray
@@ -144,11 +248,238 @@ namespace Botcraft
         std::shared_ptr<Blockstate> Raycast(const Vector3<double> &origin, const Vector3<double> &direction,
             const float max_radius, Position &out_pos, Position &out_normal);
 
+        /**
+        * Perform several raycasts in a row, for example to check the line of sight
+        * before interacting with a block. The world must be locked during the call
+        * (a shared lock is enough), so all the rays see the same world
+        *
+        * @param[in] origins the origins of the rays
+        * @param[in] directions the directions of the rays, same size as origins
+        * @param[in] max_radius maximum distance of the search, must be > 0
+        * @param[out] out_pos the positions of the blocks hit
+        * @param[out] out_normal the normals of the faces hit
+        * @return the blockstates of the hit cubes (or null), one for each ray
+        */
+        std::vector<std::shared_ptr<Blockstate> > Raycast(const std::vector<Vector3<double> >& origins, const std::vector<Vector3<double> >& directions,
+            const float max_radius, std::vector<Position>& out_pos, std::vector<Position>& out_normal);
+
         // Get the list of chunks
-        const std::map<std::pair<int, int>, std::shared_ptr<Chunk> >& GetAllChunks() const;
+        const ChunkMap& GetAllChunks() const;
+
+        /**
+        * Call a function for each block stored in the box between min and max (included).
+        * Blocks are visited section by section, in memory order. Blocks in unloaded chunks
+        * or in missing (empty) sections are skipped. The world must be locked during the call
+        * (a shared lock is enough), and fn must not modify it
+        *
+        * @param[in] min one corner of the box
+        * @param[in] max the opposite corner of the box
+        * @param[in] fn function called with the position and the block
+        */
+        void ForEachBlockInBox(const Position& min, const Position& max, const std::function<void(const Position&, const Block&)>& fn);
+
+        /**
+        * Get the position of all the blocks in the box between min and max (included)
+        * for which predicate is true. The predicate is only evaluated once per blockstate
+        * in each section palette, and sections without any matching blockstate are skipped.
+        * The world must be locked during the call (a shared lock is enough)
+        *
+        * @param[in] min one corner of the box
+        * @param[in] max the opposite corner of the box
+        * @param[in] predicate function returning true for the blockstates to find
+        * @return the positions of all the matching blocks
+        */
+        std::vector<Position> FindBlocks(const Position& min, const Position& max, const std::function<bool(const Blockstate&)>& predicate);
+
+        /**
+        * Get the position of all the blocks in the box between min and max (included)
+        * with one of the given names (for example "minecraft:chest")
+        *
+        * @param[in] min one corner of the box
+        * @param[in] max the opposite corner of the box
+        * @param[in] names names of the blocks to find
+        * @return the positions of all the matching blocks
+        */
+        std::vector<Position> FindBlocks(const Position& min, const Position& max, const std::set<std::string>& names);
+
+        /**
+        * Start tracking the positions of all the blocks with one of the given names.
+        * The index is built from the loaded chunks and then kept up to date when
+        * chunks are loaded or removed and when blocks change.
+        * The world must be locked exclusively during the call
+        *
+        * @param[in] index_name the name used to query this index later
+        * @param[in] block_names names of the blocks to track (for example "minecraft:chest")
+        */
+        void AddBlockIndex(const std::string& index_name, const std::set<std::string>& block_names);
+        // Stop tracking an index, the world must be locked exclusively during the call
+        void RemoveBlockIndex(const std::string& index_name);
+
+        /**
+        * Get the k tracked blocks of an index that are the closest to pos.
+        * The world must be locked during the call (a shared lock is enough)
+        *
+        * @param[in] index_name the name given to AddBlockIndex
+        * @param[in] pos the position to search around
+        * @param[in] k the maximum number of positions to return
+        * @return up to k positions, sorted from the closest to the farthest
+        */
+        std::vector<Position> GetNearestIndexedBlocks(const std::string& index_name, const Position& pos, const size_t k);
+
+        /**
+        * Get all the tracked blocks of an index that are within radius of pos.
+        * The world must be locked during the call (a shared lock is enough)
+        *
+        * @param[in] index_name the name given to AddBlockIndex
+        * @param[in] pos the position to search around
+        * @param[in] radius the maximum distance to pos
+        * @return the positions, sorted from the closest to the farthest
+        */
+        std::vector<Position> GetIndexedBlocksInRadius(const std::string& index_name, const Position& pos, const float radius);
+
+        /**
+        * Save all the loaded chunks (blocks, biomes, light and block entities) and the
+        * current dimension in a file. Chunks are written one after the other, in the
+        * same format as the disk cache. The world must not be locked during the call
+        *
+        * @param path the file to write
+        * @return true if the snapshot has been saved
+        */
+        bool SaveSnapshot(const std::string& path);
+
+        /**
+        * Replace all the chunks and the current dimension by the ones saved with
+        * SaveSnapshot, without any server. The file is memory mapped and the chunks
+        * are decoded before locking the world. The world must not be locked during
+        * the call. The snapshot must have been saved with the same game version
+        *
+        * @param path the file to read
+        * @return true if the snapshot has been loaded
+        */
+        bool LoadSnapshot(const std::string& path);
+
+        /**
+        * Replace the chunks between min_chunk and max_chunk (chunk coordinates, included)
+        * by generated ones, to get a world without any server (benchmarks, tests...).
+        * If no dimension has been received from a server yet, the overworld is used.
+        * Light is not computed. The world must not be locked during the call
+        *
+        * @param min_chunk_x, min_chunk_z one corner of the area, in chunk coordinates
+        * @param max_chunk_x, max_chunk_z the opposite corner of the area, in chunk coordinates
+        * @param generator function called once for each block of the chunks, with the
+        *        block position, returning the block to put there, or nullptr for air
+        */
+        void GenerateChunks(const int min_chunk_x, const int min_chunk_z, const int max_chunk_x, const int max_chunk_z,
+            const std::function<const Block*(const Position&)>& generator);
+
+        /**
+        * Get notified of the world modifications instead of scanning it. Changes are
+        * delivered in order, in one batch after each packet has been applied, without
+        * the world locked (callback can lock it to read more data). Changes made directly
+        * through the public functions (SetBlock, AddChunk...) are delivered with the next
+        * batch. To start from the current state, lock the world, read it and ignore the
+        * changes with a version <= GetVersion(). The world must not be locked during the call
+        *
+        * @param callback function called with each batch of changes, from the thread
+        *        applying the packets (or a decoding thread), must not call Unsubscribe
+        * @return an id to give to UnsubscribeFromChanges
+        */
+        const unsigned int SubscribeToChanges(const std::function<void(const std::vector<WorldChange>&)>& callback);
+        // Stop receiving changes, a batch being delivered during the
+        // call can still be received. The world must not be locked during the call
+        void UnsubscribeFromChanges(const unsigned int id);
+        // Get the version of the last change, the world
+        // must be locked during the call (a shared lock is enough)
+        const unsigned long long int GetVersion() const;
 
     private:
+        friend class WorldClientHandler;
+
+        // Get a new id for a client of a shared world
+        const unsigned int RegisterClient();
+        // Mark chunk x, z as needed by client. Return true if the packets
+        // of this client about this chunk should be applied (it's the
+        // first client needing it), false if they are duplicates
+        const bool AcquireChunk(const unsigned int client, const int x, const int z);
+        // Mark chunk x, z as not needed by client anymore. Return
+        // true if no other client needs it and it should be unloaded
+        const bool ReleaseChunk(const unsigned int client, const int x, const int z);
+        // Return true if the packets of client about chunk x, z should
+        // be applied (it's the first client needing it, or no client does)
+        const bool IsChunkOwner(const unsigned int client, const int x, const int z);
+        // Release all the chunks needed by client. Return the chunks not
+        // needed anymore, other_clients is set to true if other clients
+        // still need some chunks
+        std::vector<std::pair<int, int> > ReleaseClient(const unsigned int client, bool& other_clients);
+
         std::shared_ptr<Chunk> GetChunk(const int x, const int z);
+        // Same as GetChunk, without copying the shared_ptr
+        const Chunk* GetChunkForReading(const int x, const int z) const;
+        // Get the section containing pos for Raycast,
+        // or nullptr if it's not loaded or only has air
+        const Section* GetSectionForRaycast(const Position& pos) const;
+        // Call fn for each section intersecting the box between min and max.
+        // fn gets the position of the section first block, the section
+        // and the part of the section in the box, in section coordinates
+        void ForEachSectionInBox(const Position& min, const Position& max,
+            const std::function<void(const Position&, const Section&, const Position&, const Position&)>& fn) const;
+
+        // (Re)build the block indices entries for chunk x, z
+        void IndexChunk(const int x, const int z);
+        // Update the block indices after a block changed at pos
+        void UpdateBlockIndices(const Position& pos, const Blockstate* old_blockstate, const Blockstate* new_blockstate);
+        // Get the positions tracked by an index, sorted by distance to pos,
+        // stopping after k positions or when the distance is above max_sqr_distance
+        std::vector<Position> SearchBlockIndex(const std::string& index_name, const Position& pos, const size_t k, const double max_sqr_distance) const;
+
+        // Register a new data packet for chunk x, z and get its
+        // sequence number. The world must be locked exclusively
+        const unsigned long long int StartChunkDecoding(const int x, const int z);
+        // Queue fn on the decoding threads, or run it now if there is none
+        void RunChunkDecoding(std::function<void()>&& fn);
+        // Swap in chunk at x, z if no newer packet has been received for it
+        // since sequence, then apply the modifications received meanwhile
+        void PublishChunk(const int x, const int z, const unsigned long long int sequence, const std::shared_ptr<Chunk>& chunk);
+        // Decoding threads main loop
+        void ProcessChunkDecoding();
+        // Set blocks of chunk x, z, see ApplyBlockBatch
+        void ApplyChunkBlockBatch(const int x, const int z, const std::vector<std::pair<Position, unsigned int> >& blocks);
+        // Add chunks not received from a server (snapshot, generated...),
+        // replacing the current ones. The world must be locked exclusively
+        void InsertChunks(const std::vector<std::pair<std::pair<int, int>, std::shared_ptr<Chunk> > >& chunks);
+        // Increase the version and add a change to the journal if there
+        // are subscribers. The world must be locked exclusively
+        void RecordChange(const WorldChange::Type type, const int chunk_x, const int chunk_z, const Position& pos = Position(),
+            const Blockstate* old_blockstate = nullptr, const Blockstate* new_blockstate = nullptr);
+        // Record ChunkUnloaded for all the chunks before clearing
+        // the terrain. The world must be locked exclusively
+        void RecordAllChunksUnloaded();
+        // Move the journal to the batches waiting to be
+        // delivered. The world must be locked exclusively
+        void QueueChanges();
+        // Give the waiting batches to the subscribers, in order.
+        // The world must not be locked by this thread
+        void DeliverChanges();
+#if PROTOCOL_VERSION > 404
+        void LoadLightUpdate(const ProtocolCraft::ClientboundLightUpdatePacket& msg);
+#endif
+
+        // Apply fn now, or after chunk x, z is swapped in if it is being
+        // decoded, to keep the packets order. The world must be locked exclusively
+        template<class Fn>
+        void ApplyOrDefer(const int x, const int z, const Fn& fn)
+        {
+            if (!pending_chunks.empty())
+            {
+                auto it = pending_chunks.find({ x, z });
+                if (it != pending_chunks.end())
+                {
+                    it->second.deferred.push_back(fn);
+                    return;
+                }
+            }
+            fn();
+        }
 
     protected:
         virtual void Handle(ProtocolCraft::ClientboundLoginPacket& msg) override;
@@ -167,14 +498,44 @@ namespace Botcraft
         virtual void Handle(ProtocolCraft::ClientboundBlockEntityDataPacket& msg) override;
 
     private:
-        int cached_x;
-        int cached_z;
-        std::mutex world_mutex;
-        std::shared_ptr<Chunk> cached;
+        std::shared_mutex world_mutex;
+
+        ChunkMap terrain;
+
+        struct BlockIndex
+        {
+            // Blockstates tracked by this index
+            std::unordered_set<const Blockstate*> blockstates;
+            // Positions of the tracked blocks, grouped by chunk
+            std::map<std::pair<int, int>, std::vector<Position> > positions;
+        };
+        std::map<std::string, BlockIndex> block_indices;
 
-        std::map<std::pair<int, int>, std::shared_ptr<Chunk> > terrain;
+        struct PendingChunk
+        {
+            // Sequence number of the last data packet received for this chunk
+            unsigned long long int sequence;
+            // Modifications received while the chunk was decoded, in order
+            std::vector<std::function<void()> > deferred;
+        };
+        // Chunks being decoded, protected by world_mutex
+        std::map<std::pair<int, int>, PendingChunk> pending_chunks;
+        unsigned long long int chunk_sequence;
+
+        std::vector<std::thread> decoding_threads;
+        std::queue<std::function<void()> > decoding_queue;
+        std::mutex decoding_mutex;
+        std::condition_variable decoding_condition_variable;
+        bool decoding;
 
         bool is_shared;
+        WorldLayers layers;
+
+        // Clients needing each chunk in a shared world, the
+        // first one is the one whose packets are applied
+        std::map<std::pair<int, int>, std::vector<unsigned int> > chunk_clients;
+        unsigned int next_client_id;
+        std::mutex clients_mutex;
 #if PROTOCOL_VERSION < 719
         Dimension current_dimension;
 #else
@@ -187,5 +548,23 @@ namespace Botcraft
         std::map<std::string, unsigned int> dimension_min_y;
 #endif
         std::unique_ptr<AsyncHandler> async_handler;
+
+        // Number of changes since the world creation, protected by world_mutex
+        unsigned long long int version;
+        // True if there are subscribers, protected by world_mutex
+        bool recording_changes;
+        // Changes of the packet being applied, protected by world_mutex
+        std::vector<WorldChange> pending_changes;
+        // Subscribers and changes waiting to be delivered, in
+        // order, protected by changes_mutex. Only one thread
+        // (the one with delivering_changes set) calls the subscribers
+        std::map<unsigned int, std::function<void(const std::vector<WorldChange>&)> > change_subscribers;
+        unsigned int next_subscriber_id;
+        std::queue<std::vector<WorldChange> > change_batches;
+        bool delivering_changes;
+        std::mutex changes_mutex;
+
+        // Chunks saved on disk, nullptr if disabled
+        std::unique_ptr<RegionCache> region_cache;
     };
 } // Botcraft
\ No newline at end of file
@@ -13,6 +13,7 @@ namespace Botcraft
 {
 	class TCP_Com;
 	class Authentifier;
+	class PacketLogger;
 
 	class NetworkManager : public ProtocolCraft::Handler
 	{
@@ -28,6 +29,10 @@ namespace Botcraft
 		const ProtocolCraft::ConnectionState GetConnectionState() const;
 		const std::string& GetMyName() const;
 
+		// Set a logger to record all incoming and outgoing packets
+		// Set it to nullptr to stop logging
+		void SetPacketLogger(const std::shared_ptr<PacketLogger> logger);
+
 	private:
 		void WaitForNewPackets();
 		void ProcessPacket(const std::vector<unsigned char>& packet);
@@ -58,5 +63,6 @@ namespace Botcraft
 
 		std::string name;
 
+		std::shared_ptr<PacketLogger> packet_logger;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <chrono>
+#include <condition_variable>
+
+#include "protocolCraft/Message.hpp"
+#include "protocolCraft/enums.hpp"
+
+namespace Botcraft
+{
+    enum class PacketLogFormat
+    {
+        // One JSON object per line with the packet header, the
+        // decoded packet fields and the raw packet data hex encoded
+        JsonLines,
+        // Compact binary records, see PacketLogger::Log for the layout
+        Binary
+    };
+
+    // A packet logger that streams packets to a file.
+    // Records are written into an in-memory buffer, which
+    // is flushed to disk by a background writer thread.
+    // In JsonLines format, packet fields are streamed with
+    // NetworkType::WriteJson. Frequent packets (chunks, light,
+    // entity movements, block updates...) write their fields
+    // directly into the buffer, the others still go through
+    // their nlohmann::json Serialize.
+    // The network processing thread only pays for building the
+    // record (a copy of the payload in Binary format, the fields
+    // and the hex encoded payload in JsonLines format) for logged
+    // packets, and a counter increment for skipped ones. Disk
+    // writes never happen on this thread.
+    class PacketLogger
+    {
+    public:
+        PacketLogger(const std::string& path, const PacketLogFormat format_ = PacketLogFormat::JsonLines, const bool include_payload_ = true);
+        ~PacketLogger();
+
+        // Log only one packet every one_every packets with this id
+        // in play state. 0 disables logging for this packet id, 1 logs them all
+        void SetSamplingRate(const int packet_id, const bool outgoing, const unsigned int one_every);
+        // Sampling rate applied to all play packets without a specific rate
+        void SetDefaultSamplingRate(const unsigned int one_every);
+
+        // Log a packet. raw_packet is the uncompressed packet data,
+        // starting with the packet id VarInt.
+        // Binary record layout (all integers are little endian,
+        // whatever the host byte order):
+        // unsigned long long timestamp (µs since logger creation)
+        // unsigned char direction (0 = incoming, 1 = outgoing)
+        // char connection state
+        // int packet id
+        // unsigned int payload size
+        // payload bytes
+        void Log(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+            const bool outgoing, const ProtocolCraft::ConnectionState state);
+
+        // Number of records discarded because the writer thread
+        // couldn't keep up with the incoming rate
+        const unsigned long long GetNumDroppedRecords() const;
+
+    private:
+        const bool ShouldLog(const int packet_id, const bool outgoing, const ProtocolCraft::ConnectionState state);
+        void WriteJsonRecord(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+            const bool outgoing, const ProtocolCraft::ConnectionState state, const unsigned long long timestamp);
+        void WriteBinaryRecord(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+            const bool outgoing, const ProtocolCraft::ConnectionState state, const unsigned long long timestamp);
+        void WriterLoop();
+
+    private:
+        static const int max_sampled_id = 256;
+        // Start flushing to disk when the buffer reaches this size
+        static const size_t flush_threshold = 1 << 20;
+        // Drop records if the pending buffer reaches this size
+        static const size_t max_pending_size = 64 << 20;
+
+        PacketLogFormat format;
+        bool include_payload;
+
+        std::ofstream file;
+        std::chrono::steady_clock::time_point start_time;
+
+        std::array<std::atomic<unsigned int>, max_sampled_id> incoming_sampling;
+        std::array<std::atomic<unsigned int>, max_sampled_id> outgoing_sampling;
+        std::array<std::atomic<unsigned int>, max_sampled_id> incoming_counters;
+        std::array<std::atomic<unsigned int>, max_sampled_id> outgoing_counters;
+        // Shared by all the packets with an id >= max_sampled_id
+        std::atomic<unsigned int> incoming_other_counter;
+        std::atomic<unsigned int> outgoing_other_counter;
+        std::atomic<unsigned int> default_sampling;
+        std::atomic<unsigned long long> num_dropped;
+
+        // Records are appended to pending_buffer while
+        // the writer thread writes the other one to disk
+        std::vector<char> pending_buffer;
+        std::vector<char> writing_buffer;
+        std::mutex buffer_mutex;
+        std::condition_variable buffer_condition;
+        bool running;
+        std::thread writer_thread;
+    };
+} // Botcraft
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <tuple>
+
+#include "botcraft/Game/World/Chunk.hpp"
+#include "botcraft/Utilities/MappedFile.hpp"
+
+namespace Botcraft
+{
+    // Persistent store of the chunks on disk. Chunks are grouped by
+    // REGION_WIDTH * REGION_WIDTH in region files, one set of files per
+    // dimension. A region file starts with a header giving the position
+    // and size of each of its chunks, followed by the chunks serialized
+    // with Chunk::Serialize, each one starting on a new sector.
+    // Region files are memory mapped to be read, so only the
+    // chunks actually loaded are read from the disk.
+    // All the functions can be called from any thread
+    class RegionCache
+    {
+    public:
+        // folder must exist, max_loaded_chunks is the number of chunks
+        // kept in memory after being loaded from (or saved to) the disk
+        RegionCache(const std::string& folder_, const size_t max_loaded_chunks_ = 1024);
+
+        // Write chunk x, z on the disk, replacing the previous version
+        void Save(const int x, const int z, const std::shared_ptr<const Chunk>& chunk);
+
+        // Get chunk x, z of a dimension from the disk, or nullptr if it's
+        // not in the cache. The returned chunk must not be modified
+#if PROTOCOL_VERSION < 719
+        std::shared_ptr<const Chunk> Load(const Dimension dimension, const int x, const int z, const WorldLayers& layers);
+#else
+        std::shared_ptr<const Chunk> Load(const std::string& dimension, const int x, const int z, const WorldLayers& layers);
+#endif
+
+        static const int REGION_WIDTH = 32;
+        static const int SECTOR_SIZE = 4096;
+
+    private:
+        struct Region
+        {
+            std::string path;
+            MappedFile file;
+            // Position (in sectors) and size (in bytes) of each
+            // chunk in the file, position is 0 if not present
+            std::vector<std::pair<unsigned int, unsigned int> > entries;
+            // Size of the file in sectors
+            unsigned int num_sectors = 0;
+            // False if the file doesn't exist or can't
+            // be used, it is recreated on the next save
+            bool valid = false;
+        };
+
+        typedef std::tuple<std::string, int, int> ChunkKey;
+
+        // Get the region containing chunk x, z, reading its header
+        // if it's the first time. mutex must be locked
+        Region& GetRegion(const std::string& dimension, const int x, const int z);
+        // Add chunk to the loaded ones, removing the oldest
+        // ones if there are too many. mutex must be locked
+        void KeepLoaded(const ChunkKey& key, const std::shared_ptr<const Chunk>& chunk);
+
+#if PROTOCOL_VERSION < 719
+        static const std::string GetDimensionName(const Dimension dimension);
+#else
+        static const std::string GetDimensionName(const std::string& dimension);
+#endif
+
+    private:
+        std::mutex mutex;
+        std::string folder;
+
+        std::map<std::tuple<std::string, int, int>, Region> regions;
+
+        size_t max_loaded_chunks;
+        // Chunks loaded in memory, most recently used first
+        std::list<std::pair<ChunkKey, std::shared_ptr<const Chunk> > > loaded_chunks;
+        std::map<ChunkKey, std::list<std::pair<ChunkKey, std::shared_ptr<const Chunk> > >::iterator> loaded_chunks_index;
+    };
+} // Botcraft
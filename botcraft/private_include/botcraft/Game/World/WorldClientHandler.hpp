@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+
+#include "protocolCraft/Handler.hpp"
+
+namespace Botcraft
+{
+    class World;
+
+    // Handler between the network of one client and a shared world.
+    // The world keeps track of the clients needing each chunk, so:
+    // - a chunk is only unloaded when no client needs it anymore
+    // - the packets about a chunk (data, blocks, light...) are only
+    //   applied if they come from the first client that loaded it,
+    //   the other clients receive the same ones and would decode
+    //   everything again
+    // All the other packets are sent to the world as is
+    class WorldClientHandler : public ProtocolCraft::Handler
+    {
+    public:
+        WorldClientHandler(const std::shared_ptr<World>& world_);
+        WorldClientHandler() = delete;
+        // Release all the chunks of this client
+        ~WorldClientHandler();
+
+    protected:
+        virtual void Handle(ProtocolCraft::Message& msg) override;
+        virtual void Handle(ProtocolCraft::ClientboundRespawnPacket& msg) override;
+        virtual void Handle(ProtocolCraft::ClientboundBlockUpdatePacket& msg) override;
+        virtual void Handle(ProtocolCraft::ClientboundSectionBlocksUpdatePacket& msg) override;
+        virtual void Handle(ProtocolCraft::ClientboundForgetLevelChunkPacket& msg) override;
+#if PROTOCOL_VERSION < 757
+        virtual void Handle(ProtocolCraft::ClientboundLevelChunkPacket& msg) override;
+#else
+        virtual void Handle(ProtocolCraft::ClientboundLevelChunkWithLightPacket& msg) override;
+#endif
+#if PROTOCOL_VERSION > 404
+        virtual void Handle(ProtocolCraft::ClientboundLightUpdatePacket& msg) override;
+#endif
+        virtual void Handle(ProtocolCraft::ClientboundBlockEntityDataPacket& msg) override;
+
+    private:
+        // Release all the chunks of this client and unload the
+        // ones not needed anymore, return true if other clients
+        // still have chunks in the world
+        const bool ReleaseAllChunks();
+
+    private:
+        std::shared_ptr<World> world;
+        // Handler the packets are forwarded to
+        ProtocolCraft::Handler* world_handler;
+        unsigned int client_id;
+    };
+} // Botcraft
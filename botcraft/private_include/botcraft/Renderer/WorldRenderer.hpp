@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 
 #include <unordered_map>
+#include <array>
 #include <mutex>
 #include <memory>
 #include <vector>
@@ -45,7 +46,10 @@ namespace Botcraft
             void UpdateViewMatrix();
             void SetCameraProjection(const glm::mat4& proj);
             void UpdateFaces();
-            void UpdateChunk(const int x_, const int z_, const std::shared_ptr<const Botcraft::Chunk> chunk);
+            // neighbours are the chunks at North, West, East and South,
+            // used to know which faces on the border are visible
+            void UpdateChunk(const int x_, const int z_, const std::shared_ptr<const Botcraft::Chunk> chunk,
+                const std::array<std::shared_ptr<const Botcraft::Chunk>, 4>& neighbours);
             void UseAtlasTextureGL();
             void ClearFaces();
 
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace Botcraft
+{
+    // Read-only view of a whole file mapped in memory. The
+    // OS loads the pages when they are accessed, so opening
+    // a large file and reading a small part of it is cheap
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Map the file at path, return false if it can't be opened
+        const bool Open(const std::string& path);
+        void Close();
+
+        const bool IsOpen() const;
+        // nullptr if the file is not open or empty
+        const unsigned char* GetData() const;
+        const size_t GetSize() const;
+
+    private:
+        const unsigned char* data;
+        size_t size;
+        bool is_open;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#else
+        int file_descriptor;
+#endif
+    };
+} // Botcraft
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+namespace Botcraft
+{
+    // Unpack num_entries values of bits_per_entry bits (1 to 32) stored in data,
+    // starting from the least significant bits of the first long.
+    // If spanning is true, values are stored one after the other and can
+    // span across two longs (chunk format before 1.16). Otherwise each
+    // long contains 64 / bits_per_entry values and the remaining bits
+    // are not used. Return false if data is too small for num_entries values
+    const bool UnpackLongArray(const std::vector<unsigned long long int>& data, const unsigned char bits_per_entry,
+        const bool spanning, const int num_entries, unsigned int* output);
+} // Botcraft
@@ -24,7 +24,7 @@ namespace Botcraft
         std::shared_ptr<World> world = c.GetWorld();
         std::shared_ptr<Blockstate> blockstate;
         {
-            std::lock_guard<std::mutex> world_guard(world->GetMutex());
+            std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
             const Block* block = world->GetBlock(pos);
 
             // No block
@@ -81,7 +81,7 @@ namespace Botcraft
                 finished_sent = true;
             }
             {
-                std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                 const Block* block = world->GetBlock(pos);
 
                 if (!block || block->GetBlockstate()->IsAir())
@@ -278,7 +278,7 @@ namespace Botcraft
 
         // Check if block is air
         {
-            std::lock_guard<std::mutex> world_guard(world->GetMutex());
+            std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
 
             const Block* block = world->GetBlock(pos);
 
@@ -380,7 +380,7 @@ namespace Botcraft
             }
             if (!is_block_ok)
             {
-                std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                 const Block* block = world->GetBlock(pos);
 
                 if (block && block->GetBlockstate()->GetName() == item_name)
@@ -77,48 +77,35 @@ namespace Botcraft
                 //    6  12
                 bool is_in_fluid;
                 {
-                    std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                    std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
 
-                    const Block* block = world->GetBlock(current_node.pos);
-                    is_in_fluid = block && block->GetBlockstate()->IsFluid();
+                    // Only the occupancy of the sections is read, not the blocks
+                    is_in_fluid = world->IsFluid(current_node.pos);
 
                     // Start with 2 because if 2 is solid, no pathfinding is possible
-                    block = world->GetBlock(next_location + Position(0, 1, 0));
-                    surroundings[2] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
+                    surroundings[2] = world->IsSolid(next_location + Position(0, 1, 0)) || (is_in_fluid && world->IsFluid(next_location + Position(0, 1, 0)));
                     if (surroundings[2])
                     {
                         continue;
                     }
 
-                    block = world->GetBlock(current_node.pos + Position(0, 2, 0));
-                    surroundings[0] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
+                    surroundings[0] = world->IsSolid(current_node.pos + Position(0, 2, 0)) || (is_in_fluid && world->IsFluid(current_node.pos + Position(0, 2, 0)));
 
-                    block = world->GetBlock(next_location + Position(0, 2, 0));
-                    surroundings[1] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
-                    block = world->GetBlock(next_location);
-                    surroundings[3] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
-                    block = world->GetBlock(next_location + Position(0, -1, 0));
-                    surroundings[4] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
-                    block = world->GetBlock(next_location + Position(0, -2, 0));
-                    surroundings[5] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
-                    block = world->GetBlock(next_location + Position(0, -3, 0));
-                    surroundings[6] = block && (block->GetBlockstate()->IsSolid() || (is_in_fluid && block->GetBlockstate()->IsFluid()));
+                    surroundings[1] = world->IsSolid(next_location + Position(0, 2, 0)) || (is_in_fluid && world->IsFluid(next_location + Position(0, 2, 0)));
+                    surroundings[3] = world->IsSolid(next_location) || (is_in_fluid && world->IsFluid(next_location));
+                    surroundings[4] = world->IsSolid(next_location + Position(0, -1, 0)) || (is_in_fluid && world->IsFluid(next_location + Position(0, -1, 0)));
+                    surroundings[5] = world->IsSolid(next_location + Position(0, -2, 0)) || (is_in_fluid && world->IsFluid(next_location + Position(0, -2, 0)));
+                    surroundings[6] = world->IsSolid(next_location + Position(0, -3, 0)) || (is_in_fluid && world->IsFluid(next_location + Position(0, -3, 0)));
 
                     // You can't make large jumps if your feet are in fluid
                     if (allow_jump && !is_in_fluid)
                     {
-                        block = world->GetBlock(next_next_location + Position(0, 2, 0));
-                        surroundings[7] = block && block->GetBlockstate()->IsSolid();
-                        block = world->GetBlock(next_next_location + Position(0, 1, 0));
-                        surroundings[8] = block && block->GetBlockstate()->IsSolid();
-                        block = world->GetBlock(next_next_location);
-                        surroundings[9] = block && block->GetBlockstate()->IsSolid();
-                        block = world->GetBlock(next_next_location + Position(0, -1, 0));
-                        surroundings[10] = block && block->GetBlockstate()->IsSolid();
-                        block = world->GetBlock(next_next_location + Position(0, -2, 0));
-                        surroundings[11] = block && block->GetBlockstate()->IsSolid();
-                        block = world->GetBlock(next_next_location + Position(0, -3, 0));
-                        surroundings[12] = block && block->GetBlockstate()->IsSolid();
+                        surroundings[7] = world->IsSolid(next_next_location + Position(0, 2, 0));
+                        surroundings[8] = world->IsSolid(next_next_location + Position(0, 1, 0));
+                        surroundings[9] = world->IsSolid(next_next_location);
+                        surroundings[10] = world->IsSolid(next_next_location + Position(0, -1, 0));
+                        surroundings[11] = world->IsSolid(next_next_location + Position(0, -2, 0));
+                        surroundings[12] = world->IsSolid(next_next_location + Position(0, -3, 0));
                     }
                 }
 
@@ -223,21 +210,27 @@ namespace Botcraft
                     && !surroundings[4] && !surroundings[5]
                     && !surroundings[6])
                 {
-                    std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                    std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
 
                     const Block* block;
 
-                    for (int y = -4; next_location.y + y >= world->GetMinY(); --y)
-                    {
-                        block = world->GetBlock(next_location + Position(0, y, 0));
+                    // Nothing can stop the fall above the highest solid or fluid block
+                    const int start_y = std::min(-4, world->GetHighestBlock(next_location.x, next_location.z) - next_location.y);
 
-                        if (block && block->GetBlockstate()->IsSolid())
+                    for (int y = start_y; next_location.y + y >= world->GetMinY(); --y)
+                    {
+                        if (world->IsSolid(next_location + Position(0, y, 0)))
                         {
                             break;
                         }
 
-                        if (block && block->GetBlockstate()->IsFluid()
-                            && block->GetBlockstate()->GetName() == "minecraft:water")
+                        if (!world->IsFluid(next_location + Position(0, y, 0)))
+                        {
+                            continue;
+                        }
+
+                        block = world->GetBlock(next_location + Position(0, y, 0));
+                        if (block && block->GetBlockstate()->GetName() == "minecraft:water")
                         {
                             const float new_cost = cost[current_node.pos] + std::abs(y);
                             const Position new_pos = next_location + Position(0, y + 1, 0);
@@ -410,7 +403,7 @@ namespace Botcraft
             std::vector<Position> path;
             bool is_goal_loaded;
             {
-                std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                 is_goal_loaded = world->IsLoaded(goal);
             }
 
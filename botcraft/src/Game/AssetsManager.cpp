@@ -1,6 +1,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include "botcraft/Game/AssetsManager.hpp"
 #include "botcraft/Game/World/Block.hpp"
@@ -21,6 +22,7 @@ namespace Botcraft
     {
         std::cout << "Loading blocks from file..." << std::endl;
         LoadBlocksFile();
+        FlattenBlockstates();
         std::cout << "Done!" << std::endl;
         std::cout << "Loading biomes from file..." << std::endl;
         LoadBiomesFile();
@@ -42,6 +44,17 @@ namespace Botcraft
         return blockstates;
     }
 
+#if PROTOCOL_VERSION < 347
+    const std::shared_ptr<Blockstate>& AssetsManager::GetBlockstate(const int id, const unsigned char metadata) const
+    {
+        if (id < 0)
+        {
+            return default_blockstate;
+        }
+        return GetBlockstate(Blockstate::IdMetadataToId(id, metadata));
+    }
+#endif
+
 #if PROTOCOL_VERSION < 358
     const std::map<unsigned char, std::shared_ptr<Biome> >& AssetsManager::Biomes() const
 #else
@@ -531,6 +544,67 @@ namespace Botcraft
 #endif
     }
 
+    void AssetsManager::FlattenBlockstates()
+    {
+#if PROTOCOL_VERSION < 347
+        auto default_it = blockstates.find(-1);
+        default_blockstate = default_it == blockstates.end() ? nullptr : default_it->second.at(0);
+
+        unsigned int num_ids = 0;
+        for (auto it = blockstates.begin(); it != blockstates.end(); ++it)
+        {
+            if (it->first >= 0 && !it->second.empty())
+            {
+                num_ids = std::max(num_ids, Blockstate::IdMetadataToId(it->first, it->second.rbegin()->first) + 1);
+            }
+        }
+#else
+        auto default_it = blockstates.find(-1);
+        default_blockstate = default_it == blockstates.end() ? nullptr : default_it->second;
+
+        const unsigned int num_ids = blockstates.empty() ? 0 : std::max(0, blockstates.rbegin()->first + 1);
+#endif
+
+        flattened_blockstates = std::vector<std::shared_ptr<Blockstate> >(num_ids, default_blockstate);
+#if PROTOCOL_VERSION < 347
+        // Same fallback as before: metadata 0 if this
+        // metadata doesn't exist, default if the id doesn't
+        for (auto it = blockstates.begin(); it != blockstates.end(); ++it)
+        {
+            if (it->first < 0 || it->second.empty())
+            {
+                continue;
+            }
+            auto zero_it = it->second.find(0);
+            for (unsigned char m = 0; m < 16; ++m)
+            {
+                const unsigned int global_id = Blockstate::IdMetadataToId(it->first, m);
+                if (global_id >= num_ids)
+                {
+                    break;
+                }
+                auto it2 = it->second.find(m);
+                if (it2 != it->second.end())
+                {
+                    flattened_blockstates[global_id] = it2->second;
+                }
+                else if (zero_it != it->second.end())
+                {
+                    flattened_blockstates[global_id] = zero_it->second;
+                }
+            }
+        }
+#else
+        for (auto it = blockstates.begin(); it != blockstates.end(); ++it)
+        {
+            if (it->first >= 0)
+            {
+                flattened_blockstates[it->first] = it->second;
+            }
+        }
+#endif
+    }
+
     void AssetsManager::LoadBiomesFile()
     {
         std::string file_path = ASSETS_PATH + std::string("/custom/Biomes.json");
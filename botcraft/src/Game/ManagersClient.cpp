@@ -6,6 +6,7 @@
 #include "botcraft/Game/Entities/LocalPlayer.hpp"
 #include "botcraft/Game/World/Chunk.hpp"
 #include "botcraft/Game/World/World.hpp"
+#include "botcraft/Game/World/WorldClientHandler.hpp"
 #include "botcraft/Game/World/Block.hpp"
 #include "botcraft/Game/World/Biome.hpp"
 #include "botcraft/Game/Inventory/InventoryManager.hpp"
@@ -31,6 +32,7 @@ namespace Botcraft
 #endif
 
         world = nullptr;
+        world_handler = nullptr;
         inventory_manager = nullptr;
         entity_manager = nullptr;
 
@@ -79,6 +81,8 @@ namespace Botcraft
             m_thread_physics.join();
         }
 
+        // Release the chunks this client needed in the world
+        world_handler.reset();
         if (world && !world->IsShared())
         {
             world.reset();
@@ -110,15 +114,14 @@ namespace Botcraft
                     bool is_in_fluid = false;
                     std::lock_guard<std::mutex> player_guard(local_player->GetMutex());
                     {
-                        std::lock_guard<std::mutex> mutex_guard(world->GetMutex());
+                        std::shared_lock<std::shared_mutex> mutex_guard(world->GetMutex());
                         const Position player_position = Position(std::floor(local_player->GetX()), std::floor(local_player->GetY()), std::floor(local_player->GetZ()));
 
                         is_loaded = world->IsLoaded(player_position);
 
                         if (is_loaded)
                         {
-                            const Block* block_ptr = world->GetBlock(player_position);
-                            is_in_fluid = block_ptr && block_ptr->GetBlockstate()->IsFluid();
+                            is_in_fluid = world->IsFluid(player_position);
                         }
                     }
 
@@ -220,6 +223,8 @@ namespace Botcraft
 
         bool has_hit_down = false;
         bool has_hit_up = false;
+
+        const bool model_variants = world->GetLayers().model_variants;
         
         Position cube_pos;
         for (int x = (int)std::floor(min_player_collider.x); x < (int)std::ceil(max_player_collider.x); ++x)
@@ -234,7 +239,13 @@ namespace Botcraft
 
                     Block block;
                     {
-                        std::lock_guard<std::mutex> mutex_guard(world->GetMutex());
+                        std::shared_lock<std::shared_mutex> mutex_guard(world->GetMutex());
+                        // Most blocks around the player can be skipped
+                        // without looking at them (and copying them)
+                        if (!world->IsSolid(cube_pos) && (!is_in_fluid || !world->IsFluid(cube_pos)))
+                        {
+                            continue;
+                        }
                         const Block *block_ptr = world->GetBlock(cube_pos);
 
                         if (block_ptr == nullptr)
@@ -257,7 +268,7 @@ namespace Botcraft
                         continue;
                     }
 
-                    const std::vector<AABB> &block_colliders = block.GetBlockstate()->GetModel(block.GetModelId()).GetColliders();
+                    const std::vector<AABB> &block_colliders = block.GetBlockstate()->GetModel(model_variants ? block.GetBlockstate()->GetModelId(cube_pos) : 0).GetColliders();
 
                     for (int i = 0; i < block_colliders.size(); ++i)
                     {
@@ -374,7 +385,17 @@ namespace Botcraft
         inventory_manager = std::make_shared<InventoryManager>();
         entity_manager = std::make_shared<EntityManager>();
 
-        network_manager->AddHandler(world->GetAsyncHandler());
+        // Each client of a shared world needs its own handler
+        // so the world knows which chunks each one needs
+        if (world->IsShared())
+        {
+            world_handler = std::make_shared<WorldClientHandler>(world);
+            network_manager->AddHandler(world_handler.get());
+        }
+        else
+        {
+            network_manager->AddHandler(world->GetAsyncHandler());
+        }
         network_manager->AddHandler(inventory_manager.get());
         network_manager->AddHandler(entity_manager.get());
 
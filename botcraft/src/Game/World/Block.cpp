@@ -9,34 +9,9 @@ namespace Botcraft
         ChangeBlockstate(id_, metadata_);
     }
 
-    void Block::ChangeBlockstate(const int id_, const unsigned char metadata_, const int model_id_)
+    void Block::ChangeBlockstate(const int id_, const unsigned char metadata_)
     {
-        auto &blockstates_map = AssetsManager::getInstance().Blockstates();
-        auto it = blockstates_map.find(id_);
-        if (it != blockstates_map.end())
-        {
-            auto it2 = it->second.find(metadata_);
-            if (it2 != it->second.end())
-            {
-                blockstate = it2->second;
-            }
-            else
-            {
-                blockstate = it->second.at(0);
-            }
-        }
-        else
-        {
-            blockstate = blockstates_map.at(-1).at(0);
-        }
-        if (model_id_ < 0)
-        {
-            model_id = blockstate->GetRandomModelId();
-        }
-        else
-        {
-            model_id = model_id_;
-        }
+        blockstate = AssetsManager::getInstance().GetBlockstate(id_, metadata_);
     }
 #else
     Block::Block(const int id_)
@@ -44,37 +19,14 @@ namespace Botcraft
         ChangeBlockstate(id_);
     }
 
-    void Block::ChangeBlockstate(const int id_, const int model_id_)
+    void Block::ChangeBlockstate(const int id_)
     {
-        auto &blockstates_map = AssetsManager::getInstance().Blockstates();
-        auto it = blockstates_map.find(id_);
-        if (it != blockstates_map.end())
-        {
-            blockstate = it->second;
-        }
-        else
-        {
-            blockstate = blockstates_map.at(-1);
-        }
-
-        if (model_id_ < 0)
-        {
-            model_id = blockstate->GetRandomModelId();
-        }
-        else
-        {
-            model_id = model_id_;
-        }
+        blockstate = AssetsManager::getInstance().GetBlockstate(static_cast<unsigned int>(id_));
     }
 #endif
 
-    const std::shared_ptr<Blockstate> Block::GetBlockstate() const
+    const std::shared_ptr<Blockstate>& Block::GetBlockstate() const
     {
         return blockstate;
     }
-
-    const unsigned short Block::GetModelId() const
-    {
-        return model_id;
-    }
 } //Botcraft
\ No newline at end of file
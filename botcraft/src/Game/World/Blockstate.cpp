@@ -1,8 +1,6 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
-#include <random>
-#include <chrono>
 
 #include <nlohmann/json.hpp>
 
@@ -252,7 +250,6 @@ namespace Botcraft
 #endif
     {
         weights_sum = 0;
-        random_generator = std::mt19937(std::chrono::system_clock::now().time_since_epoch().count());
 
         if (path == "none")
         {
@@ -559,7 +556,6 @@ namespace Botcraft
 #endif
     {
         weights_sum = 1;
-        random_generator = std::mt19937(std::chrono::system_clock::now().time_since_epoch().count());
 
         models_weights = { 1 };
         models = { model_ };
@@ -582,9 +578,27 @@ namespace Botcraft
         return models[index];
     }
 
-    const unsigned char Blockstate::GetRandomModelId()
+    const unsigned char Blockstate::GetModelId(const Position& pos) const
     {
-        int random_value = std::uniform_int_distribution<int>(0, weights_sum - 1)(random_generator);
+        if (models.size() < 2)
+        {
+            return 0;
+        }
+
+        // Same position hash as vanilla (Mth.getSeed), computed
+        // with unsigned types to get java wrapping behaviour
+        const int x_hash = static_cast<int>(static_cast<unsigned int>(pos.x) * 3129871u);
+        unsigned long long int seed = static_cast<unsigned long long int>(static_cast<long long int>(x_hash)) ^
+            static_cast<unsigned long long int>(static_cast<long long int>(pos.z)) * 116129781ULL ^
+            static_cast<unsigned long long int>(static_cast<long long int>(pos.y));
+        seed = seed * seed * 42317861ULL + seed * 11ULL;
+        seed = static_cast<unsigned long long int>(static_cast<long long int>(seed) >> 16);
+
+        // One step of java.util.Random LCG to spread the bits
+        unsigned long long int lcg = (seed ^ 0x5DEECE66DULL) & ((1ULL << 48) - 1);
+        lcg = (lcg * 0x5DEECE66DULL + 0xBULL) & ((1ULL << 48) - 1);
+        int random_value = static_cast<int>((lcg >> 17) % weights_sum);
+
         for (int i = 0; i < models_weights.size(); ++i)
         {
             if (random_value < models_weights[i])
@@ -1,9 +1,15 @@
 #include "botcraft/Game/World/Chunk.hpp"
 #include "botcraft/Game/World/Section.hpp"
+#include "botcraft/Utilities/PackedArray.hpp"
 
 #include "protocolCraft/Types/NBT/TagInt.hpp"
+#include "protocolCraft/Types/NBT/TagLongArray.hpp"
+#include "protocolCraft/Types/NBT/TagString.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
 
 using namespace ProtocolCraft;
 
@@ -19,27 +25,34 @@ namespace Botcraft
     };
 
 #if PROTOCOL_VERSION < 719
-    Chunk::Chunk(const Dimension &dim)
+    Chunk::Chunk(const Dimension &dim, const WorldLayers& layers_)
 #elif PROTOCOL_VERSION < 757
-    Chunk::Chunk(const std::string& dim)
+    Chunk::Chunk(const std::string& dim, const WorldLayers& layers_)
 #else
-    Chunk::Chunk(const int min_y_, const unsigned int height_, const std::string& dim)
+    Chunk::Chunk(const int min_y_, const unsigned int height_, const std::string& dim, const WorldLayers& layers_)
 #endif
     {
         dimension = dim;
+        layers = layers_;
 #if PROTOCOL_VERSION > 756
         height = height_;
         min_y = min_y_;
 #endif
+        // If biomes are disabled, the vector is left empty
+        if (layers.biomes)
+        {
 #if PROTOCOL_VERSION < 358
-        biomes = std::vector<unsigned char>(CHUNK_WIDTH * CHUNK_WIDTH, 0);
+            biomes = std::vector<unsigned char>(CHUNK_WIDTH * CHUNK_WIDTH, 0);
 #elif PROTOCOL_VERSION < 552
-        biomes = std::vector<int>(CHUNK_WIDTH * CHUNK_WIDTH, 0);
+            biomes = std::vector<int>(CHUNK_WIDTH * CHUNK_WIDTH, 0);
 #else
-        // Each section has 64 biomes, one for each 4*4*4 cubes
-        biomes = std::vector<int>(64 * height / SECTION_HEIGHT, 0);
+            // Each section has 64 biomes, one for each 4*4*4 cubes
+            biomes = std::vector<int>(64 * height / SECTION_HEIGHT, 0);
 #endif
+        }
         sections = std::vector<std::shared_ptr<Section> >(height / SECTION_HEIGHT);
+        heightmaps[0].fill(0);
+        heightmaps[1].fill(0);
 
 #if USE_GUI
         modified_since_last_rendered = true;
@@ -49,6 +62,7 @@ namespace Botcraft
     Chunk::Chunk(const Chunk& c)
     {
         dimension = c.dimension;
+        layers = c.layers;
         biomes = c.biomes;
 
 #if PROTOCOL_VERSION > 756
@@ -56,28 +70,20 @@ namespace Botcraft
         min_y = c.min_y;
 #endif
 
-        sections = std::vector<std::shared_ptr<Section> >(height / SECTION_HEIGHT);
-        for (int i = 0; i < c.sections.size(); i++)
-        {
-            if (c.sections[i] == nullptr)
-            {
-                sections[i] = nullptr;
-            }
-            else
-            {
-                sections[i] = std::make_shared<Section>(*c.sections[i]);
-            }
-        }
+        // Only the pointers are copied, sections are copied
+        // on write and block entities are never modified in place
+        sections = c.sections;
+        block_entities = c.block_entities;
+        heightmaps = c.heightmaps;
 
-        for (auto it = c.block_entities_data.begin(); it != c.block_entities_data.end(); it++)
-        {
-            block_entities_data[it->first] = std::make_shared<NBT>(*it->second);
-        }
+#if USE_GUI
+        modified_since_last_rendered = c.modified_since_last_rendered;
+#endif
     }
 
     const Position Chunk::BlockCoordsToChunkCoords(const Position& pos)
     {
-        return Position(static_cast<int>(floor(pos.x / (double)CHUNK_WIDTH)), 0, static_cast<int>(floor(pos.z / (double)CHUNK_WIDTH)));
+        return Position(pos.x >> CHUNK_WIDTH_BITS, 0, pos.z >> CHUNK_WIDTH_BITS);
     }
 
     const int Chunk::GetMinY() const
@@ -90,6 +96,11 @@ namespace Botcraft
         return height;
     }
 
+    const WorldLayers& Chunk::GetLayers() const
+    {
+        return layers;
+    }
+
 #if USE_GUI
     const bool Chunk::GetModifiedSinceLastRender() const
     {
@@ -120,6 +131,8 @@ namespace Botcraft
             return;
         }
 
+        std::vector<unsigned int> palette_indices(Section::NUM_BLOCKS);
+
         //The chunck sections
         for (int sectionY = 0; sectionY < height / SECTION_HEIGHT; ++sectionY)
         {
@@ -171,9 +184,6 @@ namespace Botcraft
                 }
             }
 
-            //A mask 0...01..1 with bits_per_block ones
-            unsigned int individual_value_mask = (unsigned int)((1 << bits_per_block) - 1);
-
             //Data array length
             int data_array_size = ReadData<VarInt>(iter, length);
 
@@ -184,115 +194,49 @@ namespace Botcraft
                 data_array[i] = ReadData<unsigned long long int>(iter, length);
             }
 
-            //Blocks data
-#if PROTOCOL_VERSION > 712
-            int bit_offset = 0;
-#endif
-            Position pos;
-            for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
-            {
-                pos.y = block_y + sectionY * SECTION_HEIGHT + min_y;
-                for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                {
-                    pos.z = block_z;
-                    for (int block_x = 0; block_x < CHUNK_WIDTH; ++block_x)
-                    {
-                        pos.x = block_x;
+            //Blocks data, from protocol version 713 entries
+            //no longer span across multiple longs
 #if PROTOCOL_VERSION > 712
-                        // From protocol version 713, the compacted array format has been adjusted so that
-                        //individual entries no longer span across multiple longs
-                        if (64 - (bit_offset % 64) < bits_per_block)
-                        {
-                            bit_offset += 64 - (bit_offset % 64);
-                        }
-                        int start_long_index = bit_offset / 64;
-                        int end_long_index = start_long_index;
-                        int start_offset = bit_offset % 64;
-                        bit_offset += bits_per_block;
-#else
-                        int block_index = (((block_y * SECTION_HEIGHT) + block_z) * CHUNK_WIDTH) + block_x;
-                        int start_long_index = (block_index * bits_per_block) / 64;
-                        int start_offset = (block_index * bits_per_block) % 64;
-                        int end_long_index = ((block_index + 1) * bits_per_block - 1) / 64;
-#endif
-                        unsigned int raw_id;
-                        if (start_long_index == end_long_index)
-                        {
-                            raw_id = (unsigned int)(data_array[start_long_index] >> start_offset);
-                        }
-                        else
-                        {
-                            int end_offset = 64 - start_offset;
-                            raw_id = (unsigned int)(data_array[start_long_index] >> start_offset | data_array[end_long_index] << end_offset);
-                        }
-                        raw_id &= individual_value_mask;
-
-                        if (palette_type != Palette::GlobalPalette)
-                        {
-                            raw_id = palette[raw_id];
-                        }
-
-#if PROTOCOL_VERSION < 347
-                        unsigned int id;
-                        unsigned char metadata;
-
-                        Blockstate::IdToIdMetadata(raw_id, id, metadata);
-
-                        SetBlock(pos, id, metadata);
+            if (!UnpackLongArray(data_array, bits_per_block, false, Section::NUM_BLOCKS, palette_indices.data()))
 #else
-                        SetBlock(pos, raw_id);
+            if (!UnpackLongArray(data_array, bits_per_block, true, Section::NUM_BLOCKS, palette_indices.data()))
 #endif
-                    }
-                }
+            {
+                std::cerr << "Error, not enough data for section blocks. Stop loading chunk data" << std::endl;
+                return;
             }
+            LoadSectionBlocks(sectionY, palette_type == Palette::GlobalPalette ? nullptr : &palette, palette_indices.data());
 
 #if PROTOCOL_VERSION <= 404
-            //Block light
-            for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
+            //Block light, already in the format we store it
+            //(SetSectionXXXLight do nothing if light is disabled)
+            if (length < Section::LIGHT_DATA_SIZE)
             {
-                pos.y = block_y + sectionY * SECTION_HEIGHT + min_y;
-                for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                {
-                    pos.z = block_z;
-                    for (int block_x = 0; block_x < CHUNK_WIDTH; block_x += 2)
-                    {
-                        pos.x = block_x;
-                        unsigned char two_light_values = ReadData<unsigned char>(iter, length);
-
-                        SetBlockLight(pos, two_light_values & 0x0F);
-                        pos.x = block_x + 1;
-                        SetBlockLight(pos, (two_light_values >> 4) & 0x0F);
-                    }
-                }
+                std::cerr << "Error, not enough data for block light. Stop loading chunk data" << std::endl;
+                return;
             }
+            SetSectionBlockLight(sectionY, reinterpret_cast<const char*>(&*iter));
+            iter += Section::LIGHT_DATA_SIZE;
+            length -= Section::LIGHT_DATA_SIZE;
 
             //Sky light
             if (GetDimension() == Dimension::Overworld)
             {
-                for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
+                if (length < Section::LIGHT_DATA_SIZE)
                 {
-                    pos.y = block_y + sectionY * SECTION_HEIGHT + min_y;
-                    for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                    {
-                        pos.z = block_z;
-                        for (int block_x = 0; block_x < CHUNK_WIDTH; block_x += 2)
-                        {
-                            pos.x = block_x;
-                            unsigned char two_light_values = ReadData<unsigned char>(iter, length);
-
-                            SetSkyLight(pos, two_light_values & 0x0F);
-                            pos.x = block_x + 1;
-                            SetSkyLight(pos, (two_light_values >> 4) & 0x0F);
-                        }
-                    }
+                    std::cerr << "Error, not enough data for sky light. Stop loading chunk data" << std::endl;
+                    return;
                 }
+                SetSectionSkyLight(sectionY, reinterpret_cast<const char*>(&*iter));
+                iter += Section::LIGHT_DATA_SIZE;
+                length -= Section::LIGHT_DATA_SIZE;
             }
 #endif
         }
 
 #if PROTOCOL_VERSION < 552
         //The biomes
-        if (ground_up_continuous)
+        if (ground_up_continuous && layers.biomes)
         {
             for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
             {
@@ -323,6 +267,8 @@ namespace Botcraft
             return;
         }
 
+        std::vector<unsigned int> palette_indices(Section::NUM_BLOCKS);
+
         //The chunck sections
         for (int sectionY = 0; sectionY < height / SECTION_HEIGHT; ++sectionY)
         {
@@ -360,9 +306,6 @@ namespace Botcraft
                 break;
             }
 
-            //A mask 0...01..1 with bits_per_block ones
-            unsigned int individual_value_mask = (unsigned int)((1 << bits_per_block) - 1);
-
             //Data array length
             int data_array_size = ReadData<VarInt>(iter, length);
 
@@ -374,56 +317,20 @@ namespace Botcraft
             }
 
             //Blocks data
-            int bit_offset = 0;
-            Position pos;
             if (block_count != 0)
             {
-                for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
+                if (palette_type == Palette::SingleValue)
                 {
-                    pos.y = block_y + sectionY * SECTION_HEIGHT + min_y;
-                    for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                    {
-                        pos.z = block_z;
-                        for (int block_x = 0; block_x < CHUNK_WIDTH; ++block_x)
-                        {
-                            pos.x = block_x;
-                            if (palette_type == Palette::SingleValue)
-                            {
-                                SetBlock(pos, palette_value);
-                                continue;
-                            }
-
-                            // Entries don't span across multiple longs
-                            if (64 - (bit_offset % 64) < bits_per_block)
-                            {
-                                bit_offset += 64 - (bit_offset % 64);
-                            }
-                            int start_long_index = bit_offset / 64;
-                            int end_long_index = start_long_index;
-                            int start_offset = bit_offset % 64;
-                            bit_offset += bits_per_block;
-
-                            unsigned int raw_id;
-                            if (start_long_index == end_long_index)
-                            {
-                                raw_id = (unsigned int)(data_array[start_long_index] >> start_offset);
-                            }
-                            else
-                            {
-                                int end_offset = 64 - start_offset;
-                                raw_id = (unsigned int)(data_array[start_long_index] >> start_offset | data_array[end_long_index] << end_offset);
-                            }
-                            raw_id &= individual_value_mask;
-
-                            if (palette_type == Palette::SectionPalette)
-                            {
-                                raw_id = palette[raw_id];
-                            }
-
-                            SetBlock(pos, raw_id);
-                        }
-                    }
+                    palette = std::vector<int>(1, palette_value);
+                    std::fill(palette_indices.begin(), palette_indices.end(), 0);
+                }
+                // Entries don't span across multiple longs
+                else if (!UnpackLongArray(data_array, bits_per_block, false, Section::NUM_BLOCKS, palette_indices.data()))
+                {
+                    std::cerr << "Error, not enough data for section blocks. Stop loading chunk data" << std::endl;
+                    return;
                 }
+                LoadSectionBlocks(sectionY, palette_type == Palette::GlobalPalette ? nullptr : &palette, palette_indices.data());
             }
             else
             {
@@ -455,12 +362,22 @@ namespace Botcraft
                 break;
             }
 
-            //A mask 0...01..1 with bits_per_biome ones
-            individual_value_mask = (unsigned int)((1 << bits_per_biome) - 1);
-
             //Data array length
             data_array_size = ReadData<VarInt>(iter, length);
 
+            if (!layers.biomes)
+            {
+                // Skip the biomes data
+                if (length < data_array_size * sizeof(unsigned long long int))
+                {
+                    std::cerr << "Error, not enough data for biomes. Stop loading chunk data" << std::endl;
+                    return;
+                }
+                iter += data_array_size * sizeof(unsigned long long int);
+                length -= data_array_size * sizeof(unsigned long long int);
+                continue;
+            }
+
             //Data array
             data_array = std::vector<unsigned long long int>(data_array_size);
             for (int i = 0; i < data_array_size; ++i)
@@ -468,50 +385,29 @@ namespace Botcraft
                 data_array[i] = ReadData<unsigned long long int>(iter, length);
             }
 
-            //Biomes data
-            bit_offset = 0;
-            for (int block_y = 0; block_y < SECTION_HEIGHT / 4; ++block_y)
+            //Biomes data, 64 per section, one for each 4*4*4 cube
+            if (palette_type == Palette::SingleValue)
             {
-                for (int block_z = 0; block_z < CHUNK_WIDTH / 4; ++block_z)
-                {
-                    for (int block_x = 0; block_x < CHUNK_WIDTH / 4; ++block_x)
-                    {
-                        const int biome_index = sectionY * 64 + block_y * 16 + block_z * 4 + block_x;
-                        if (palette_type == Palette::SingleValue)
-                        {
-                            SetBiome(biome_index, palette_value);
-                            continue;
-                        }
-
-                        // Entries don't span across multiple longs
-                        if (64 - (bit_offset % 64) < bits_per_biome)
-                        {
-                            bit_offset += 64 - (bit_offset % 64);
-                        }
-                        int start_long_index = bit_offset / 64;
-                        int end_long_index = start_long_index;
-                        int start_offset = bit_offset % 64;
-                        bit_offset += bits_per_biome;
-
-                        unsigned int raw_id;
-                        if (start_long_index == end_long_index)
-                        {
-                            raw_id = (unsigned int)(data_array[start_long_index] >> start_offset);
-                        }
-                        else
-                        {
-                            int end_offset = 64 - start_offset;
-                            raw_id = (unsigned int)(data_array[start_long_index] >> start_offset | data_array[end_long_index] << end_offset);
-                        }
-                        raw_id &= individual_value_mask;
+                std::fill(biomes.begin() + sectionY * 64, biomes.begin() + (sectionY + 1) * 64, palette_value);
+                continue;
+            }
 
-                        if (palette_type == Palette::SectionPalette)
-                        {
-                            raw_id = palette[raw_id];
-                        }
+            // Entries don't span across multiple longs
+            if (!UnpackLongArray(data_array, bits_per_biome, false, 64, palette_indices.data()))
+            {
+                std::cerr << "Error, not enough data for biomes. Stop loading chunk data" << std::endl;
+                return;
+            }
 
-                        SetBiome(biome_index, raw_id);
-                    }
+            for (int i = 0; i < 64; ++i)
+            {
+                if (palette_type == Palette::SectionPalette)
+                {
+                    biomes[sectionY * 64 + i] = palette_indices[i] < palette.size() ? palette[palette_indices[i]] : 0;
+                }
+                else
+                {
+                    biomes[sectionY * 64 + i] = palette_indices[i];
                 }
             }
         }
@@ -522,33 +418,37 @@ namespace Botcraft
 #endif
 
 #if PROTOCOL_VERSION < 757
-    void Chunk::LoadChunkBlockEntitiesData(const std::vector<NBT>& block_entities)
+    void Chunk::LoadChunkBlockEntitiesData(const std::vector<NBT>& new_block_entities)
 #else
-    void Chunk::LoadChunkBlockEntitiesData(const std::vector<BlockEntityInfo>& block_entities)
+    void Chunk::LoadChunkBlockEntitiesData(const std::vector<BlockEntityInfo>& new_block_entities)
 #endif
     {
         // Block entities data
-        block_entities_data.clear();
+        block_entities = nullptr;
+
+        if (!layers.block_entities)
+        {
+            return;
+        }
 
-        for (int i = 0; i < block_entities.size(); ++i)
+        for (int i = 0; i < new_block_entities.size(); ++i)
         {
 #if PROTOCOL_VERSION < 757
-            if (block_entities[i].HasData())
+            if (new_block_entities[i].HasData())
             {
-                std::shared_ptr<TagInt> tag_x = std::dynamic_pointer_cast<TagInt>(block_entities[i].GetTag("x"));
-                std::shared_ptr<TagInt> tag_y = std::dynamic_pointer_cast<TagInt>(block_entities[i].GetTag("y"));
-                std::shared_ptr<TagInt> tag_z = std::dynamic_pointer_cast<TagInt>(block_entities[i].GetTag("z"));
+                std::shared_ptr<TagInt> tag_x = std::dynamic_pointer_cast<TagInt>(new_block_entities[i].GetTag("x"));
+                std::shared_ptr<TagInt> tag_y = std::dynamic_pointer_cast<TagInt>(new_block_entities[i].GetTag("y"));
+                std::shared_ptr<TagInt> tag_z = std::dynamic_pointer_cast<TagInt>(new_block_entities[i].GetTag("z"));
 
                 if (tag_x && tag_y && tag_z)
                 {
-                    block_entities_data[Position((tag_x->GetValue() % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, tag_y->GetValue(), (tag_z->GetValue() % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH)] = std::make_shared<NBT>(block_entities[i]);
+                    AddBlockEntity(Position((tag_x->GetValue() % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, tag_y->GetValue(), (tag_z->GetValue() % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH), new_block_entities[i]);
                 }
             }
 #else
-            const int x = (block_entities[i].GetPackedXZ() & 15) << 4;
-            const int z = (block_entities[i].GetPackedXZ() & 15);
-            // And what about the type ???
-            block_entities_data[Position((x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, block_entities[i].GetY(), (z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH)] = std::make_shared<NBT>(block_entities[i].GetTag());
+            const int x = new_block_entities[i].GetPackedXZ() >> 4;
+            const int z = new_block_entities[i].GetPackedXZ() & 15;
+            AddBlockEntity(Position(x, new_block_entities[i].GetY(), z), new_block_entities[i].GetTag(), new_block_entities[i].GetType());
 #endif
         }
 
@@ -557,189 +457,789 @@ namespace Botcraft
 #endif
     }
 
+#if PROTOCOL_VERSION < 757
     void Chunk::SetBlockEntityData(const Position& pos, const ProtocolCraft::NBT& block_entity)
+#else
+    void Chunk::SetBlockEntityData(const Position& pos, const ProtocolCraft::NBT& block_entity, const int type)
+#endif
     {
-        if (pos.x < -1 || pos.x > CHUNK_WIDTH || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < -1 || pos.z > CHUNK_WIDTH)
+        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return;
+        }
+
+        if (!layers.block_entities)
         {
             return;
         }
 
-        block_entities_data[pos] = std::make_shared<NBT>(block_entity);
+#if PROTOCOL_VERSION < 757
+        AddBlockEntity(pos, block_entity);
+#else
+        AddBlockEntity(pos, block_entity, type);
+#endif
 
 #if USE_GUI
         modified_since_last_rendered = true;
 #endif
     }
 
-    void Chunk::RemoveBlockEntityData(const Position& pos)
+    static inline int GetBlockEntityIndex(const Position& pos, const int min_y)
+    {
+        return pos.x | (pos.z << CHUNK_WIDTH_BITS) | ((pos.y - min_y) << (2 * CHUNK_WIDTH_BITS));
+    }
+
+    template<class Entry>
+    static inline bool CompareBlockEntityIndex(const Entry& entry, const int index)
     {
-        block_entities_data.erase(pos);
+        return entry.index < index;
     }
 
-    const std::shared_ptr<NBT> Chunk::GetBlockEntityData(const Position& pos) const
+    void Chunk::RemoveBlockEntityData(const Position& pos)
     {
-        auto it = block_entities_data.find(pos);
-        if (it == block_entities_data.end())
+        if (block_entities == nullptr || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
         {
-            return nullptr;
+            return;
+        }
+
+        const int index = GetBlockEntityIndex(pos, min_y);
+        auto it = std::lower_bound(block_entities->entries.begin(), block_entities->entries.end(), index, CompareBlockEntityIndex<BlockEntities::Entry>);
+        if (it == block_entities->entries.end() || it->index != index)
+        {
+            return;
         }
 
-        return it->second;
+        if (block_entities->entries.size() == 1)
+        {
+            block_entities = nullptr;
+            return;
+        }
+
+        const size_t entry_position = std::distance(block_entities->entries.begin(), it);
+        BlockEntities* mutable_block_entities = GetMutableBlockEntities();
+        mutable_block_entities->unused_size += mutable_block_entities->entries[entry_position].size;
+        mutable_block_entities->entries.erase(mutable_block_entities->entries.begin() + entry_position);
+        if (mutable_block_entities->unused_size > mutable_block_entities->data.size() / 2)
+        {
+            mutable_block_entities->Compact();
+        }
     }
 
-    const Block *Chunk::GetBlock(const Position &pos) const
+    const std::shared_ptr<const NBT> Chunk::GetBlockEntityData(const Position& pos) const
     {
-        if (pos.x < -1 || pos.x > CHUNK_WIDTH || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < -1 || pos.z > CHUNK_WIDTH)
+        if (block_entities == nullptr || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
         {
             return nullptr;
         }
 
-        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        const int index = GetBlockEntityIndex(pos, min_y);
+        auto it = std::lower_bound(block_entities->entries.begin(), block_entities->entries.end(), index, CompareBlockEntityIndex<BlockEntities::Entry>);
+        if (it == block_entities->entries.end() || it->index != index)
         {
             return nullptr;
         }
 
-        return sections[(pos.y - min_y) / SECTION_HEIGHT]->data_blocks.data() + (((pos.y - min_y) % SECTION_HEIGHT) * (CHUNK_WIDTH + 2) * (CHUNK_WIDTH + 2) + (pos.z + 1) * (CHUNK_WIDTH + 2) + pos.x + 1);
+        // NBT are only decoded when asked for
+        std::shared_ptr<NBT> output = std::make_shared<NBT>();
+        try
+        {
+            ReadIterator iter = block_entities->data.begin() + it->offset;
+            size_t length = it->size;
+            output->Read(iter, length);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error decoding block entity data at " << pos.x << ", " << pos.y << ", " << pos.z << ": " << e.what() << std::endl;
+            return nullptr;
+        }
+
+        return output;
     }
 
-#if PROTOCOL_VERSION < 347
-    void Chunk::SetBlock(const Position &pos, const unsigned int id, unsigned char metadata, const int model_id)
+#if PROTOCOL_VERSION < 757
+    std::vector<Position> Chunk::GetBlockEntitiesPositions(const std::string& type) const
 #else
-    void Chunk::SetBlock(const Position &pos, const unsigned int id, const int model_id)
+    std::vector<Position> Chunk::GetBlockEntitiesPositions(const int type) const
 #endif
     {
-        if (pos.x < -1 || pos.x > CHUNK_WIDTH || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < -1 || pos.z > CHUNK_WIDTH)
+        std::vector<Position> output;
+        if (block_entities == nullptr)
         {
-            return;
+            return output;
         }
 
-        if (!sections[(pos.y  - min_y) / SECTION_HEIGHT])
+#if PROTOCOL_VERSION < 757
+        int type_index = -1;
+        if (!type.empty())
         {
-            if (id == 0)
-            {
-                return;
-            }
-            else
+            auto it = std::find(block_entities->types.begin(), block_entities->types.end(), type);
+            if (it == block_entities->types.end())
             {
-                AddSection((pos.y - min_y) / SECTION_HEIGHT);
+                return output;
             }
+            type_index = static_cast<int>(std::distance(block_entities->types.begin(), it));
         }
-        Block *block = sections[(pos.y - min_y) / SECTION_HEIGHT]->data_blocks.data() + (((pos.y - min_y) % SECTION_HEIGHT) * (CHUNK_WIDTH + 2) * (CHUNK_WIDTH + 2) + (pos.z + 1) * (CHUNK_WIDTH + 2) + pos.x + 1);
-
-
-#if PROTOCOL_VERSION < 347
-        block->ChangeBlockstate(id, metadata, model_id);
 #else
-        block->ChangeBlockstate(id, model_id);
+        const int type_index = type;
 #endif
 
-#if USE_GUI
-        modified_since_last_rendered = true;
-#endif
+        for (int i = 0; i < block_entities->entries.size(); ++i)
+        {
+            const BlockEntities::Entry& entry = block_entities->entries[i];
+            if (type_index == -1 || entry.type == type_index)
+            {
+                output.push_back(Position(entry.index & (CHUNK_WIDTH - 1), (entry.index >> (2 * CHUNK_WIDTH_BITS)) + min_y, (entry.index >> CHUNK_WIDTH_BITS) & (CHUNK_WIDTH - 1)));
+            }
+        }
+
+        return output;
     }
 
-    void Chunk::SetBlock(const Position& pos, const Block* block)
+    Chunk::BlockEntities* Chunk::GetMutableBlockEntities()
     {
-        if (block == nullptr)
+        // Same as sections, other owners can only be
+        // added while the world is locked for writing
+        if (block_entities == nullptr)
         {
-#if PROTOCOL_VERSION < 347
-            SetBlock(pos, 0, 0, -1);
-#else
-            SetBlock(pos, 0, -1);
-#endif
+            block_entities = std::make_shared<BlockEntities>();
         }
-        else
+        else if (block_entities.use_count() > 1)
         {
-#if PROTOCOL_VERSION < 347
-            SetBlock(pos, block->GetBlockstate()->GetId(), block->GetBlockstate()->GetMetadata(), block->GetModelId());
-#else
-            SetBlock(pos, block->GetBlockstate()->GetId(), block->GetModelId());
-#endif
+            block_entities = std::make_shared<BlockEntities>(*block_entities);
         }
+
+        return block_entities.get();
     }
-    const unsigned char Chunk::GetBlockLight(const Position &pos) const
+
+#if PROTOCOL_VERSION < 757
+    void Chunk::AddBlockEntity(const Position& pos, const NBT& block_entity)
+#else
+    void Chunk::AddBlockEntity(const Position& pos, const NBT& block_entity, const int type)
+#endif
     {
         if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
         {
-            return 0;
+            return;
         }
-        
-        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+
+        BlockEntities* mutable_block_entities = GetMutableBlockEntities();
+
+        BlockEntities::Entry entry;
+        entry.index = GetBlockEntityIndex(pos, min_y);
+        entry.offset = mutable_block_entities->data.size();
+        block_entity.Write(mutable_block_entities->data);
+        entry.size = mutable_block_entities->data.size() - entry.offset;
+#if PROTOCOL_VERSION < 757
+        std::shared_ptr<TagString> tag_id = std::dynamic_pointer_cast<TagString>(block_entity.GetTag("id"));
+        entry.type = tag_id == nullptr ? -1 : mutable_block_entities->FindOrAddType(tag_id->GetValue());
+#else
+        entry.type = type;
+#endif
+
+        std::vector<BlockEntities::Entry>& entries = mutable_block_entities->entries;
+        // Block entities are often sent in order, check the end first
+        auto it = (entries.empty() || entries.back().index < entry.index) ? entries.end() :
+            std::lower_bound(entries.begin(), entries.end(), entry.index, CompareBlockEntityIndex<BlockEntities::Entry>);
+        if (it != entries.end() && it->index == entry.index)
         {
-            return 0;
+#if PROTOCOL_VERSION > 756
+            if (entry.type == -1)
+            {
+                entry.type = it->type;
+            }
+#endif
+            mutable_block_entities->unused_size += it->size;
+            *it = entry;
+            if (mutable_block_entities->unused_size > mutable_block_entities->data.size() / 2)
+            {
+                mutable_block_entities->Compact();
+            }
+        }
+        else
+        {
+            entries.insert(it, entry);
         }
-
-        return sections[(pos.y - min_y) / SECTION_HEIGHT]->block_light[((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x];
     }
 
-    void Chunk::SetBlockLight(const Position &pos, const unsigned char v)
+#if PROTOCOL_VERSION < 757
+    const int Chunk::BlockEntities::FindOrAddType(const std::string& type)
     {
-        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        if (type.empty())
         {
-            return;
+            return -1;
         }
 
-        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        for (int i = 0; i < types.size(); ++i)
         {
-            AddSection((pos.y - min_y)/ SECTION_HEIGHT);
+            if (types[i] == type)
+            {
+                return i;
+            }
         }
 
-        sections[(pos.y - min_y) / SECTION_HEIGHT]->block_light[((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x] = v;
+        types.push_back(type);
+        return static_cast<int>(types.size() - 1);
+    }
+#endif
 
-        // Not necessary as we don't render lights
-//#if USE_GUI
-//        modified_since_last_rendered = true;
-//#endif
+    void Chunk::BlockEntities::Compact()
+    {
+        std::vector<unsigned char> new_data;
+        new_data.reserve(data.size() - unused_size);
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            const size_t new_offset = new_data.size();
+            new_data.insert(new_data.end(), data.begin() + entries[i].offset, data.begin() + entries[i].offset + entries[i].size);
+            entries[i].offset = new_offset;
+        }
+        data = std::move(new_data);
+        unused_size = 0;
     }
 
-    const unsigned char Chunk::GetSkyLight(const Position &pos) const
+    const Block *Chunk::GetBlock(const Position &pos) const
     {
-#if PROTOCOL_VERSION < 719
-        if (dimension != Dimension::Overworld
-#else
-        if (dimension != "minecraft:overworld"
-#endif
-            || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
         {
-            return 0;
+            return nullptr;
         }
 
         if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
         {
-            return 0;
+            return nullptr;
         }
 
-        return sections[(pos.y - min_y) / SECTION_HEIGHT]->sky_light[((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x];
+        return sections[(pos.y - min_y) / SECTION_HEIGHT]->GetBlock(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x);
     }
 
-    void Chunk::SetSkyLight(const Position &pos, const unsigned char v)
-    {
-#if PROTOCOL_VERSION < 719
-        if (dimension != Dimension::Overworld
+#if PROTOCOL_VERSION < 347
+    void Chunk::SetBlock(const Position &pos, const unsigned int id, unsigned char metadata)
 #else
-        if (dimension != "minecraft:overworld"
+    void Chunk::SetBlock(const Position &pos, const unsigned int id)
 #endif
-            || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+    {
+        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
         {
             return;
         }
 
-        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        if (!sections[(pos.y  - min_y) / SECTION_HEIGHT])
         {
-            AddSection((pos.y - min_y) / SECTION_HEIGHT);
+            if (id == 0)
+            {
+                return;
+            }
+            else
+            {
+                AddSection((pos.y - min_y) / SECTION_HEIGHT);
+            }
         }
+#if PROTOCOL_VERSION < 347
+        const Block block(id, metadata);
+#else
+        const Block block(id);
+#endif
+        GetMutableSection((pos.y - min_y) / SECTION_HEIGHT)->SetBlock(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x, block);
+        UpdateHeightmaps(pos, block.GetBlockstate().get());
+
+#if USE_GUI
+        modified_since_last_rendered = true;
+#endif
+    }
+
+    void Chunk::SetBlock(const Position& pos, const Block* block)
+    {
+        if (block == nullptr)
+        {
+#if PROTOCOL_VERSION < 347
+            SetBlock(pos, 0, 0);
+#else
+            SetBlock(pos, 0u);
+#endif
+        }
+        else
+        {
+            if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+            {
+                return;
+            }
+
+            if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+            {
+                if (block->GetBlockstate()->IsAir())
+                {
+                    return;
+                }
+                AddSection((pos.y - min_y) / SECTION_HEIGHT);
+            }
+
+            // No need to look for the blockstate again, just copy the block
+            GetMutableSection((pos.y - min_y) / SECTION_HEIGHT)->SetBlock(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x, *block);
+            UpdateHeightmaps(pos, block->GetBlockstate().get());
+
+#if USE_GUI
+            modified_since_last_rendered = true;
+#endif
+        }
+    }
+
+    void Chunk::SetSectionBlocks(const int y, const std::vector<std::pair<int, Block> >& blocks,
+        std::vector<std::pair<const Blockstate*, const Blockstate*> >* blockstates)
+    {
+        if (blockstates != nullptr)
+        {
+            blockstates->assign(blocks.size(), { nullptr, nullptr });
+        }
+
+        if (y < 0 || y >= sections.size() || blocks.empty())
+        {
+            return;
+        }
+
+        if (!sections[y])
+        {
+            bool only_air = true;
+            for (int i = 0; i < blocks.size() && only_air; ++i)
+            {
+                only_air = blocks[i].second.GetBlockstate()->IsAir();
+            }
+            if (only_air)
+            {
+                return;
+            }
+            AddSection(y);
+        }
+
+        // The section is copied (if shared) only once for all the blocks
+        Section* section = GetMutableSection(y);
+        for (int i = 0; i < blocks.size(); ++i)
+        {
+            const int index = blocks[i].first;
+            if (index < 0 || index >= Section::NUM_BLOCKS)
+            {
+                continue;
+            }
+
+            if (blockstates != nullptr)
+            {
+                const Block* old_block = section->GetBlock(index);
+                (*blockstates)[i] = { old_block ? old_block->GetBlockstate().get() : nullptr, blocks[i].second.GetBlockstate().get() };
+            }
+            section->SetBlock(index, blocks[i].second);
+            UpdateHeightmaps(Position(index & (CHUNK_WIDTH - 1), min_y + y * SECTION_HEIGHT + index / (CHUNK_WIDTH * CHUNK_WIDTH), (index >> CHUNK_WIDTH_BITS) & (CHUNK_WIDTH - 1)),
+                blocks[i].second.GetBlockstate().get());
+        }
+
+#if USE_GUI
+        modified_since_last_rendered = true;
+#endif
+    }
+
+    static inline bool IsInHeightmap(const Blockstate* blockstate, const Heightmap heightmap)
+    {
+        switch (heightmap)
+        {
+        case Heightmap::MotionBlocking:
+            return blockstate->IsSolid() || blockstate->IsFluid();
+        case Heightmap::WorldSurface:
+            return !blockstate->IsAir();
+        default:
+            return false;
+        }
+    }
+
+    const int Chunk::GetHighestBlock(const int x, const int z, const Heightmap heightmap) const
+    {
+        if (x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
+        {
+            return min_y - 1;
+        }
+
+        return min_y + heightmaps[static_cast<int>(heightmap)][z * CHUNK_WIDTH + x] - 1;
+    }
+
+    void Chunk::ComputeHeightmaps()
+    {
+        ComputeHeightmap(Heightmap::MotionBlocking);
+        ComputeHeightmap(Heightmap::WorldSurface);
+    }
+
+#if PROTOCOL_VERSION > 442
+    void Chunk::LoadHeightmaps(const NBT& heightmaps_data)
+    {
+        ComputeHeightmap(Heightmap::MotionBlocking);
+
+        std::shared_ptr<TagLongArray> tag = std::dynamic_pointer_cast<TagLongArray>(heightmaps_data.GetTag("WORLD_SURFACE"));
+        if (tag == nullptr)
+        {
+            ComputeHeightmap(Heightmap::WorldSurface);
+            return;
+        }
+
+        // Values between 0 and height included
+        unsigned char bits_per_entry = 1;
+        while ((1 << bits_per_entry) < height + 1)
+        {
+            bits_per_entry++;
+        }
+
+        const std::vector<unsigned long long int> data(tag->GetValues().begin(), tag->GetValues().end());
+        std::array<unsigned int, CHUNK_WIDTH * CHUNK_WIDTH> values;
+        // From protocol version 713 entries no longer span across multiple longs
+#if PROTOCOL_VERSION > 712
+        if (!UnpackLongArray(data, bits_per_entry, false, CHUNK_WIDTH * CHUNK_WIDTH, values.data()))
+#else
+        if (!UnpackLongArray(data, bits_per_entry, true, CHUNK_WIDTH * CHUNK_WIDTH, values.data()))
+#endif
+        {
+            ComputeHeightmap(Heightmap::WorldSurface);
+            return;
+        }
+
+        std::array<short, CHUNK_WIDTH * CHUNK_WIDTH>& world_surface = heightmaps[static_cast<int>(Heightmap::WorldSurface)];
+        for (int i = 0; i < CHUNK_WIDTH * CHUNK_WIDTH; ++i)
+        {
+            world_surface[i] = static_cast<short>(std::min(values[i], static_cast<unsigned int>(height)));
+        }
+    }
+#endif
+
+    void Chunk::UpdateHeightmaps(const Position& pos, const Blockstate* blockstate)
+    {
+        const int column = pos.z * CHUNK_WIDTH + pos.x;
+        const short block_height = static_cast<short>(pos.y - min_y + 1);
+
+        for (int i = 0; i < heightmaps.size(); ++i)
+        {
+            short& column_height = heightmaps[i][column];
+            if (IsInHeightmap(blockstate, static_cast<Heightmap>(i)))
+            {
+                column_height = std::max(column_height, block_height);
+                continue;
+            }
+
+            if (column_height != block_height)
+            {
+                continue;
+            }
+
+            // The highest block has been removed, look for the next one below
+            column_height = 0;
+            for (int y = pos.y - 1; y >= min_y; --y)
+            {
+                const Block* block = GetBlock(Position(pos.x, y, pos.z));
+                if (block == nullptr)
+                {
+                    // Missing section, jump to the one below
+                    y -= (y - min_y) % SECTION_HEIGHT;
+                    continue;
+                }
+                if (IsInHeightmap(block->GetBlockstate().get(), static_cast<Heightmap>(i)))
+                {
+                    column_height = static_cast<short>(y - min_y + 1);
+                    break;
+                }
+            }
+        }
+    }
+
+    void Chunk::ComputeHeightmap(const Heightmap heightmap)
+    {
+        std::array<short, CHUNK_WIDTH * CHUNK_WIDTH>& column_heights = heightmaps[static_cast<int>(heightmap)];
+        column_heights.fill(0);
+
+        int remaining_columns = CHUNK_WIDTH * CHUNK_WIDTH;
+        for (int s = static_cast<int>(sections.size()) - 1; s >= 0 && remaining_columns > 0; --s)
+        {
+            if (!sections[s] || sections[s]->GetNonAirCount() == 0)
+            {
+                continue;
+            }
+
+            if (heightmap == Heightmap::MotionBlocking)
+            {
+                // Look at 64 columns at once in the occupancy masks
+                const std::array<unsigned long long int, Section::NUM_BLOCKS / 64>& solid_mask = sections[s]->GetSolidMask();
+                const std::array<unsigned long long int, Section::NUM_BLOCKS / 64>& fluid_mask = sections[s]->GetFluidMask();
+                const int words_per_layer = CHUNK_WIDTH * CHUNK_WIDTH / 64;
+                for (int y = SECTION_HEIGHT - 1; y >= 0 && remaining_columns > 0; --y)
+                {
+                    for (int w = 0; w < words_per_layer; ++w)
+                    {
+                        const unsigned long long int blocks = solid_mask[y * words_per_layer + w] | fluid_mask[y * words_per_layer + w];
+                        if (blocks == 0)
+                        {
+                            continue;
+                        }
+                        for (int b = 0; b < 64; ++b)
+                        {
+                            const int column = w * 64 + b;
+                            if (((blocks >> b) & 1) && column_heights[column] == 0)
+                            {
+                                column_heights[column] = static_cast<short>(s * SECTION_HEIGHT + y + 1);
+                                remaining_columns--;
+                            }
+                        }
+                    }
+                }
+                continue;
+            }
+
+            // Skip the sections without any block of this heightmap
+            const std::deque<Block>& palette = sections[s]->GetPalette();
+            bool has_heightmap_blocks = false;
+            for (int i = 0; i < palette.size() && !has_heightmap_blocks; ++i)
+            {
+                has_heightmap_blocks = IsInHeightmap(palette[i].GetBlockstate().get(), heightmap);
+            }
+            if (!has_heightmap_blocks)
+            {
+                continue;
+            }
+
+            for (int column = 0; column < CHUNK_WIDTH * CHUNK_WIDTH; ++column)
+            {
+                if (column_heights[column] != 0)
+                {
+                    continue;
+                }
+                for (int y = SECTION_HEIGHT - 1; y >= 0; --y)
+                {
+                    if (IsInHeightmap(sections[s]->GetBlock(y * CHUNK_WIDTH * CHUNK_WIDTH + column)->GetBlockstate().get(), heightmap))
+                    {
+                        column_heights[column] = static_cast<short>(s * SECTION_HEIGHT + y + 1);
+                        remaining_columns--;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    const bool Chunk::IsSolid(const Position& pos) const
+    {
+        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return false;
+        }
+
+        const Section* section = sections[(pos.y - min_y) / SECTION_HEIGHT].get();
+        return section != nullptr && section->IsSolid(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x);
+    }
+
+    const bool Chunk::IsFluid(const Position& pos) const
+    {
+        if (pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return false;
+        }
+
+        const Section* section = sections[(pos.y - min_y) / SECTION_HEIGHT].get();
+        return section != nullptr && section->IsFluid(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x);
+    }
+
+    const unsigned char Chunk::GetBlockLight(const Position &pos) const
+    {
+        if (!layers.light || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return 0;
+        }
+        
+        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        {
+            return 0;
+        }
+
+        return sections[(pos.y - min_y) / SECTION_HEIGHT]->GetBlockLight(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x);
+    }
+
+    void Chunk::SetBlockLight(const Position &pos, const unsigned char v)
+    {
+        if (!layers.light || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return;
+        }
+
+        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        {
+            AddSection((pos.y - min_y)/ SECTION_HEIGHT);
+        }
+
+        GetMutableSection((pos.y - min_y) / SECTION_HEIGHT)->SetBlockLight(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x, v);
 
-        sections[(pos.y - min_y) / SECTION_HEIGHT]->block_light[((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x] = v;
         // Not necessary as we don't render lights
 //#if USE_GUI
 //        modified_since_last_rendered = true;
 //#endif
     }
 
+    const unsigned char Chunk::GetSkyLight(const Position &pos) const
+    {
+#if PROTOCOL_VERSION < 719
+        if (dimension != Dimension::Overworld
+#else
+        if (dimension != "minecraft:overworld"
+#endif
+            || !layers.light || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return 0;
+        }
+
+        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        {
+            return 0;
+        }
+
+        return sections[(pos.y - min_y) / SECTION_HEIGHT]->GetSkyLight(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x);
+    }
+
+    void Chunk::SetSkyLight(const Position &pos, const unsigned char v)
+    {
+#if PROTOCOL_VERSION < 719
+        if (dimension != Dimension::Overworld
+#else
+        if (dimension != "minecraft:overworld"
+#endif
+            || !layers.light || pos.x < 0 || pos.x > CHUNK_WIDTH - 1 || pos.y < min_y || pos.y > height + min_y - 1 || pos.z < 0 || pos.z > CHUNK_WIDTH - 1)
+        {
+            return;
+        }
+
+        if (!sections[(pos.y - min_y) / SECTION_HEIGHT])
+        {
+            AddSection((pos.y - min_y) / SECTION_HEIGHT);
+        }
+
+        GetMutableSection((pos.y - min_y) / SECTION_HEIGHT)->SetSkyLight(((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + pos.z * CHUNK_WIDTH + pos.x, v);
+        // Not necessary as we don't render lights
+//#if USE_GUI
+//        modified_since_last_rendered = true;
+//#endif
+    }
+
+    void Chunk::SetSectionBlockLight(const int y, const char* data)
+    {
+        if (!layers.light || y < 0 || y >= sections.size())
+        {
+            return;
+        }
+
+        if (!sections[y])
+        {
+            // Missing sections already have no light
+            if (data == nullptr)
+            {
+                return;
+            }
+            AddSection(y);
+        }
+
+        if (data == nullptr)
+        {
+            GetMutableSection(y)->FillBlockLight(0);
+        }
+        else
+        {
+            GetMutableSection(y)->SetBlockLightData(data);
+        }
+    }
+
+    void Chunk::SetSectionSkyLight(const int y, const char* data)
+    {
+#if PROTOCOL_VERSION < 719
+        if (dimension != Dimension::Overworld
+#else
+        if (dimension != "minecraft:overworld"
+#endif
+            || !layers.light || y < 0 || y >= sections.size())
+        {
+            return;
+        }
+
+        if (!sections[y])
+        {
+            if (data == nullptr)
+            {
+                return;
+            }
+            AddSection(y);
+        }
+
+        if (data == nullptr)
+        {
+            GetMutableSection(y)->FillSkyLight(0);
+        }
+        else
+        {
+            GetMutableSection(y)->SetSkyLightData(data);
+        }
+    }
+
+#if PROTOCOL_VERSION > 404
+#if PROTOCOL_VERSION < 755
+    void Chunk::LoadLightData(const int light_mask, const int empty_light_mask,
+        const std::vector<std::vector<char> >& data, const bool sky)
+#else
+    void Chunk::LoadLightData(const std::vector<unsigned long long int>& light_mask, const std::vector<unsigned long long int>& empty_light_mask,
+        const std::vector<std::vector<char> >& data, const bool sky)
+#endif
+    {
+        int counter_arrays = 0;
+
+        const int num_sections = height / SECTION_HEIGHT + 2;
+
+        for (int i = 0; i < num_sections; ++i)
+        {
+            // First and last arrays are for the sections
+            // below and above the world, we don't store them
+            const int section_y = i - 1;
+
+#if PROTOCOL_VERSION < 755
+            if ((light_mask >> i) & 1)
+#else
+            if ((light_mask.size() > i / 64) && (light_mask[i / 64] >> (i % 64)) & 1)
+#endif
+            {
+                if (i > 0 && i < num_sections - 1 &&
+                    data[counter_arrays].size() >= Section::LIGHT_DATA_SIZE)
+                {
+                    // Data is already in the format we use, just copy it
+                    if (sky)
+                    {
+                        SetSectionSkyLight(section_y, data[counter_arrays].data());
+                    }
+                    else
+                    {
+                        SetSectionBlockLight(section_y, data[counter_arrays].data());
+                    }
+                }
+                counter_arrays++;
+            }
+#if PROTOCOL_VERSION < 755
+            else if ((empty_light_mask >> i) & 1)
+#else
+            else if ((empty_light_mask.size() > i / 64) && (empty_light_mask[i / 64] >> (i % 64)) & 1)
+#endif
+            {
+                if (i > 0 && i < num_sections - 1)
+                {
+                    if (sky)
+                    {
+                        SetSectionSkyLight(section_y, nullptr);
+                    }
+                    else
+                    {
+                        SetSectionBlockLight(section_y, nullptr);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
 #if PROTOCOL_VERSION < 358
 	const unsigned char Chunk::GetBiome(const int x, const int z) const
 	{
-		if (x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
+		if (!layers.biomes || x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
 		{
 			return 0;
 		}
@@ -749,7 +1249,7 @@ namespace Botcraft
 
 	void Chunk::SetBiome(const int x, const int z, const unsigned char b)
 	{
-		if (x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
+		if (!layers.biomes || x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
 		{
 			return;
 		}
@@ -764,7 +1264,7 @@ namespace Botcraft
 #elif PROTOCOL_VERSION < 552
 	const int Chunk::GetBiome(const int x, const int z) const
 	{
-		if (x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
+		if (!layers.biomes || x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
 		{
 			return 0;
 		}
@@ -774,7 +1274,7 @@ namespace Botcraft
 
 	void Chunk::SetBiome(const int x, const int z, const int b)
 	{
-		if (x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
+		if (!layers.biomes || x < 0 || x > CHUNK_WIDTH - 1 || z < 0 || z > CHUNK_WIDTH - 1)
 		{
 			return;
 		}
@@ -794,7 +1294,7 @@ namespace Botcraft
 
 	const int Chunk::GetBiome(const int i) const
 	{
-		if (i < 0 || i > biomes.size() - 1)
+		if (!layers.biomes || i < 0 || i > biomes.size() - 1)
 		{
 			return 0;
 		}
@@ -804,6 +1304,11 @@ namespace Botcraft
 
 	void Chunk::SetBiomes(const std::vector<int>& new_biomes)
 	{
+		if (!layers.biomes)
+		{
+			return;
+		}
+
 		if (new_biomes.size() != 64 * height / SECTION_HEIGHT)
 		{
 			std::cerr << "Warning, trying to set biomes with a wrong size" << std::endl;
@@ -824,7 +1329,7 @@ namespace Botcraft
 
 	void Chunk::SetBiome(const int i, const int new_biome)
 	{
-		if (i < 0 || i > biomes.size() - 1)
+		if (!layers.biomes || i < 0 || i > biomes.size() - 1)
 		{
 			return;
 		}
@@ -837,181 +1342,286 @@ namespace Botcraft
 	}
 #endif
 
-    void Chunk::UpdateNeighbour(const std::shared_ptr<Chunk> neighbour, const Orientation direction)
+#if PROTOCOL_VERSION < 719
+    const Dimension Chunk::GetDimension() const
+#else
+    const std::string& Chunk::GetDimension() const
+#endif
+    {
+        return dimension;
+    }
+
+    const bool Chunk::HasSection(const int y) const
     {
-        Position this_dest_position = Position(0, 0, 0);
-        Position this_src_position = Position(0, 0, 0);
-        Position neighbour_dest_position = Position(0, 0, 0);
-        Position neighbour_src_position = Position(0, 0, 0);
-        switch (direction)
+        return sections[y] != nullptr;
+    }
+
+    void Chunk::AddSection(const int y)
+    {
+#if PROTOCOL_VERSION < 719
+        sections[y] = std::shared_ptr<Section>(new Section(dimension == Dimension::Overworld));
+#else
+        sections[y] = std::shared_ptr<Section>(new Section(dimension == "minecraft:overworld"));
+#endif
+    }
+
+    const std::shared_ptr<const Section> Chunk::GetSection(const int y) const
+    {
+        return sections[y];
+    }
+
+    Section* Chunk::GetMutableSection(const int y)
+    {
+        // Other owners can only be added while the world is locked
+        // for writing or through the intern table (which also holds
+        // a reference), so if we are the only owner no one else can
+        // be reading this section
+        if (sections[y].use_count() > 1)
         {
-            // The neighbour is on "the left" on the x axis
-        case Orientation::West:
-            this_dest_position.x = -1;
-            this_src_position.x = 0;
-            neighbour_src_position.x = CHUNK_WIDTH - 1;
-            neighbour_dest_position.x = CHUNK_WIDTH;
+            sections[y] = std::make_shared<Section>(*sections[y]);
+        }
+
+        return sections[y].get();
+    }
 
-            for (int y = min_y; y < height + min_y; ++y)
+    void Chunk::InternSections()
+    {
+        for (int i = 0; i < sections.size(); ++i)
+        {
+            if (sections[i])
             {
-                this_dest_position.y = y;
-                this_src_position.y = y;
-                neighbour_src_position.y = y;
-                neighbour_dest_position.y = y;
-                for (int z = 0; z < CHUNK_WIDTH; ++z)
-                {
-                    this_dest_position.z = z;
-                    this_src_position.z = z;
-                    neighbour_src_position.z = z;
-                    neighbour_dest_position.z = z;
-                    // If the neighbour chunk is not loaded, just add air instead
-                    if (neighbour == nullptr)
-                    {
-                        SetBlock(this_dest_position, nullptr);
-                    }
-                    // Otherwise, get the blocks and set this chunk's blocks
-                    // on the neighbour
-                    else
-                    {
-                        SetBlock(this_dest_position, neighbour->GetBlock(neighbour_src_position));
-                        neighbour->SetBlock(neighbour_dest_position, GetBlock(this_src_position));
-                    }
-                }
+                sections[i] = Section::Intern(sections[i]);
+            }
+        }
+    }
+
+    void Chunk::Serialize(WriteContainer& container) const
+    {
+        WriteData<int>(GetMinY(), container);
+        WriteData<int>(GetHeight(), container);
+
+        WriteData<VarInt>(static_cast<int>(biomes.size()), container);
+        for (int i = 0; i < biomes.size(); ++i)
+        {
+#if PROTOCOL_VERSION < 358
+            WriteData<unsigned char>(biomes[i], container);
+#else
+            WriteData<VarInt>(biomes[i], container);
+#endif
+        }
+
+        for (int i = 0; i < sections.size(); ++i)
+        {
+            WriteData<bool>(sections[i] != nullptr, container);
+            if (sections[i])
+            {
+                sections[i]->Serialize(container);
+            }
+        }
+
+        // Block entities NBT are written as is, without decoding them
+        if (block_entities == nullptr)
+        {
+            WriteData<VarInt>(0, container);
+            return;
+        }
+        WriteData<VarInt>(static_cast<int>(block_entities->entries.size()), container);
+        for (int i = 0; i < block_entities->entries.size(); ++i)
+        {
+            const BlockEntities::Entry& entry = block_entities->entries[i];
+            WriteData<VarInt>(entry.index, container);
+#if PROTOCOL_VERSION < 757
+            WriteData<std::string>(entry.type == -1 ? "" : block_entities->types[entry.type], container);
+#else
+            WriteData<VarInt>(entry.type, container);
+#endif
+            WriteData<VarInt>(static_cast<int>(entry.size), container);
+            container.insert(container.end(), block_entities->data.begin() + entry.offset, block_entities->data.begin() + entry.offset + entry.size);
+        }
+    }
+
+#if PROTOCOL_VERSION < 719
+    std::shared_ptr<Chunk> Chunk::Deserialize(ReadIterator& iter, size_t& length, const Dimension& dim, const WorldLayers& layers_)
+#else
+    std::shared_ptr<Chunk> Chunk::Deserialize(ReadIterator& iter, size_t& length, const std::string& dim, const WorldLayers& layers_)
+#endif
+    {
+        const int serialized_min_y = ReadData<int>(iter, length);
+        const int serialized_height = ReadData<int>(iter, length);
+        if (serialized_height <= 0 || serialized_height % SECTION_HEIGHT != 0 || serialized_min_y % SECTION_HEIGHT != 0)
+        {
+            throw std::runtime_error("Invalid height in serialized chunk");
+        }
+
+#if PROTOCOL_VERSION < 757
+        if (serialized_min_y != min_y || serialized_height != height)
+        {
+            throw std::runtime_error("Invalid height in serialized chunk");
+        }
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(dim, layers_);
+#else
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(serialized_min_y, serialized_height, dim, layers_);
+#endif
+
+        const int num_biomes = ReadData<VarInt>(iter, length);
+        // Chunks saved without biomes keep the default ones
+        if (num_biomes < 0 || (chunk->layers.biomes && num_biomes != 0 && num_biomes != chunk->biomes.size()))
+        {
+            throw std::runtime_error("Invalid biomes in serialized chunk");
+        }
+        for (int i = 0; i < num_biomes; ++i)
+        {
+#if PROTOCOL_VERSION < 358
+            const unsigned char biome = ReadData<unsigned char>(iter, length);
+#else
+            const int biome = ReadData<VarInt>(iter, length);
+#endif
+            if (chunk->layers.biomes)
+            {
+                chunk->biomes[i] = biome;
             }
-            break;
-            // The neighbour is on "the right" on the x axis
-        case Orientation::East:
-            this_dest_position.x = CHUNK_WIDTH;
-            this_src_position.x = CHUNK_WIDTH - 1;
-            neighbour_src_position.x = 0;
-            neighbour_dest_position.x = -1;
-
-            for (int y = min_y; y < height + min_y; ++y)
-            {
-                this_dest_position.y = y;
-                this_src_position.y = y;
-                neighbour_src_position.y = y;
-                neighbour_dest_position.y = y;
-                for (int z = 0; z < CHUNK_WIDTH; ++z)
+        }
+
+        for (int i = 0; i < chunk->sections.size(); ++i)
+        {
+            if (ReadData<bool>(iter, length))
+            {
+                chunk->AddSection(i);
+                chunk->sections[i]->Deserialize(iter, length);
+                if (!chunk->layers.light)
                 {
-                    this_dest_position.z = z;
-                    this_src_position.z = z;
-                    neighbour_src_position.z = z;
-                    neighbour_dest_position.z = z;
-                    // If the neighbour chunk is not loaded, just add air instead
-                    if (neighbour == nullptr)
-                    {
-                        SetBlock(this_dest_position, nullptr);
-                    }
-                    // Otherwise, get the blocks and set this chunk's blocks
-                    // on the neighbour
-                    else
-                    {
-                        SetBlock(this_dest_position, neighbour->GetBlock(neighbour_src_position));
-                        neighbour->SetBlock(neighbour_dest_position, GetBlock(this_src_position));
-                    }
+                    chunk->sections[i]->FillBlockLight(0);
+                    chunk->sections[i]->FillSkyLight(0);
                 }
             }
-            break;
-            // The neighbour is on "the left" on the z axis
-        case Orientation::North:
-            this_dest_position.z = -1;
-            this_src_position.z = 0;
-            neighbour_src_position.z = CHUNK_WIDTH - 1;
-            neighbour_dest_position.z = CHUNK_WIDTH;
-
-            for (int y = min_y; y < height + min_y; ++y)
-            {
-                this_dest_position.y = y;
-                this_src_position.y = y;
-                neighbour_src_position.y = y;
-                neighbour_dest_position.y = y;
-                for (int x = 0; x < CHUNK_WIDTH; ++x)
+        }
+
+        const int num_block_entities = ReadData<VarInt>(iter, length);
+        if (num_block_entities > 0 && chunk->layers.block_entities)
+        {
+            chunk->block_entities = std::make_shared<BlockEntities>();
+        }
+        for (int i = 0; i < num_block_entities; ++i)
+        {
+            BlockEntities::Entry entry;
+            entry.index = ReadData<VarInt>(iter, length);
+#if PROTOCOL_VERSION < 757
+            const std::string type = ReadData<std::string>(iter, length);
+#else
+            entry.type = ReadData<VarInt>(iter, length);
+#endif
+            const int size = ReadData<VarInt>(iter, length);
+            // Entries are written sorted by index
+            if (entry.index < 0 || entry.index >= CHUNK_WIDTH * CHUNK_WIDTH * chunk->height || size < 0 || size > length ||
+                (chunk->block_entities != nullptr && !chunk->block_entities->entries.empty() && chunk->block_entities->entries.back().index >= entry.index))
+            {
+                throw std::runtime_error("Invalid block entity in serialized chunk");
+            }
+
+            if (chunk->block_entities != nullptr)
+            {
+#if PROTOCOL_VERSION < 757
+                entry.type = chunk->block_entities->FindOrAddType(type);
+#endif
+                entry.offset = chunk->block_entities->data.size();
+                entry.size = size;
+                chunk->block_entities->data.insert(chunk->block_entities->data.end(), iter, iter + size);
+                chunk->block_entities->entries.push_back(entry);
+            }
+            iter += size;
+            length -= size;
+        }
+
+        chunk->ComputeHeightmaps();
+
+        return chunk;
+    }
+
+    void Chunk::LoadSectionBlocks(const int y, const std::vector<int>* palette, unsigned int* indices)
+    {
+        std::deque<Block> blocks;
+        if (palette != nullptr)
+        {
+            for (int i = 0; i < palette->size(); ++i)
+            {
+#if PROTOCOL_VERSION < 347
+                unsigned int id;
+                unsigned char metadata;
+                Blockstate::IdToIdMetadata((*palette)[i], id, metadata);
+                blocks.emplace_back(id, metadata);
+#else
+                blocks.emplace_back((*palette)[i]);
+#endif
+            }
+            if (blocks.empty())
+            {
+                blocks.emplace_back();
+            }
+            for (int i = 0; i < Section::NUM_BLOCKS; ++i)
+            {
+                if (indices[i] >= blocks.size())
                 {
-                    this_dest_position.x = x;
-                    this_src_position.x = x;
-                    neighbour_src_position.x = x;
-                    neighbour_dest_position.x = x;
-                    // If the neighbour chunk is not loaded, just add air instead
-                    if (neighbour == nullptr)
-                    {
-                        SetBlock(this_dest_position, nullptr);
-                    }
-                    // Otherwise, get the blocks and set this chunk's blocks
-                    // on the neighbour
-                    else
-                    {
-                        SetBlock(this_dest_position, neighbour->GetBlock(neighbour_src_position));
-                        neighbour->SetBlock(neighbour_dest_position, GetBlock(this_src_position));
-                    }
+                    indices[i] = 0;
                 }
             }
-            break;
-            // The neighbour is on "the right" on the z axis
-        case Orientation::South:
-            this_dest_position.z = CHUNK_WIDTH;
-            this_src_position.z = CHUNK_WIDTH - 1;
-            neighbour_src_position.z = 0;
-            neighbour_dest_position.z = -1;
-
-            for (int y = min_y; y < height + min_y; ++y)
-            {
-                this_dest_position.y = y;
-                this_src_position.y = y;
-                neighbour_src_position.y = y;
-                neighbour_dest_position.y = y;
-                for (int x = 0; x < CHUNK_WIDTH; ++x)
+        }
+        else
+        {
+            // Build a palette with the ids used in this section
+            std::unordered_map<unsigned int, unsigned int> palette_map;
+            unsigned int last_id = indices[0];
+            unsigned int last_index = 0;
+#if PROTOCOL_VERSION < 347
+            unsigned int id;
+            unsigned char metadata;
+            Blockstate::IdToIdMetadata(last_id, id, metadata);
+            blocks.emplace_back(id, metadata);
+#else
+            blocks.emplace_back(last_id);
+#endif
+            palette_map[last_id] = 0;
+            for (int i = 0; i < Section::NUM_BLOCKS; ++i)
+            {
+                if (indices[i] != last_id)
                 {
-                    this_dest_position.x = x;
-                    this_src_position.x = x;
-                    neighbour_src_position.x = x;
-                    neighbour_dest_position.x = x;
-                    // If the neighbour chunk is not loaded, just add air instead
-                    if (neighbour == nullptr)
+                    last_id = indices[i];
+                    auto it = palette_map.find(last_id);
+                    if (it == palette_map.end())
                     {
-                        SetBlock(this_dest_position, nullptr);
+                        last_index = static_cast<unsigned int>(blocks.size());
+                        palette_map[last_id] = last_index;
+#if PROTOCOL_VERSION < 347
+                        Blockstate::IdToIdMetadata(last_id, id, metadata);
+                        blocks.emplace_back(id, metadata);
+#else
+                        blocks.emplace_back(last_id);
+#endif
                     }
-                    // Otherwise, get the blocks and set this chunk's blocks
-                    // on the neighbour
                     else
                     {
-                        SetBlock(this_dest_position, neighbour->GetBlock(neighbour_src_position));
-                        neighbour->SetBlock(neighbour_dest_position, GetBlock(this_src_position));
+                        last_index = it->second;
                     }
                 }
+                indices[i] = last_index;
             }
-            break;
-        default:
-            break;
         }
-    }
 
-#if PROTOCOL_VERSION < 719
-    const Dimension Chunk::GetDimension() const
-#else
-    const std::string& Chunk::GetDimension() const
-#endif
-    {
-        return dimension;
-    }
-
-    const std::map<Position, std::shared_ptr<NBT> >& Chunk::GetBlockEntitiesData() const
-    {
-        return block_entities_data;
-    }
-
-    const bool Chunk::HasSection(const int y) const
-    {
-        return sections[y] != nullptr;
-    }
+        if (!sections[y])
+        {
+            // Don't create a section to fill it with air
+            bool only_air = true;
+            for (int i = 0; i < blocks.size() && only_air; ++i)
+            {
+                only_air = blocks[i].GetBlockstate()->IsAir();
+            }
+            if (only_air)
+            {
+                return;
+            }
+            AddSection(y);
+        }
 
-    void Chunk::AddSection(const int y)
-    {
-#if PROTOCOL_VERSION < 719
-        sections[y] = std::shared_ptr<Section>(new Section(dimension == Dimension::Overworld));
-#else
-        sections[y] = std::shared_ptr<Section>(new Section(dimension == "minecraft:overworld"));
-#endif
+        GetMutableSection(y)->LoadPalettedData(std::move(blocks), indices);
     }
 
 } //Botcraft
\ No newline at end of file
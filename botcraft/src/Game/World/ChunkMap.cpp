@@ -0,0 +1,145 @@
+#include "botcraft/Game/World/ChunkMap.hpp"
+
+namespace Botcraft
+{
+    // Minimum number of slots once something has been inserted
+    static const unsigned char MIN_CAPACITY_BITS = 6;
+
+    ChunkMap::ChunkMap()
+    {
+        num_elements = 0;
+        capacity_bits = 0;
+        mask = 0;
+    }
+
+    ChunkMap::const_iterator ChunkMap::begin() const
+    {
+        return const_iterator(&slots, 0);
+    }
+
+    ChunkMap::const_iterator ChunkMap::end() const
+    {
+        return const_iterator(&slots, slots.size());
+    }
+
+    ChunkMap::const_iterator ChunkMap::find(const key_type& key) const
+    {
+        if (num_elements == 0)
+        {
+            return end();
+        }
+
+        const size_t slot = FindSlot(key.first, key.second);
+        if (slots[slot].second == nullptr)
+        {
+            return end();
+        }
+        return const_iterator(&slots, slot);
+    }
+
+    void ChunkMap::insert_or_assign(const key_type& key, const std::shared_ptr<Chunk>& chunk)
+    {
+        if (chunk == nullptr)
+        {
+            erase(key);
+            return;
+        }
+
+        // Keep the load factor under 1/2 so probe sequences stay short
+        if (slots.empty() || 2 * (num_elements + 1) > slots.size())
+        {
+            Rehash(slots.empty() ? MIN_CAPACITY_BITS : capacity_bits + 1);
+        }
+
+        const size_t slot = FindSlot(key.first, key.second);
+        if (slots[slot].second == nullptr)
+        {
+            num_elements++;
+        }
+        slots[slot].first = key;
+        slots[slot].second = chunk;
+    }
+
+    void ChunkMap::erase(const const_iterator& it)
+    {
+        if (it.index >= slots.size() || slots[it.index].second == nullptr)
+        {
+            return;
+        }
+
+        // Backward shift deletion: move back the following elements of the
+        // probe sequence that would not be reachable anymore from their
+        // home slot, so we don't need tombstones
+        size_t hole = it.index;
+        size_t current = hole;
+        while (true)
+        {
+            current = (current + 1) & mask;
+            if (slots[current].second == nullptr)
+            {
+                break;
+            }
+
+            const size_t home = Hash(slots[current].first.first, slots[current].first.second);
+            // Is home cyclically in ]hole, current]?
+            const bool stays = hole <= current ? (hole < home && home <= current) : (hole < home || home <= current);
+            if (stays)
+            {
+                continue;
+            }
+
+            slots[hole] = std::move(slots[current]);
+            hole = current;
+        }
+
+        slots[hole].second = nullptr;
+        num_elements--;
+    }
+
+    size_t ChunkMap::erase(const key_type& key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+
+        erase(it);
+        return 1;
+    }
+
+    void ChunkMap::clear()
+    {
+        slots.clear();
+        num_elements = 0;
+        capacity_bits = 0;
+        mask = 0;
+    }
+
+    size_t ChunkMap::size() const
+    {
+        return num_elements;
+    }
+
+    bool ChunkMap::empty() const
+    {
+        return num_elements == 0;
+    }
+
+    void ChunkMap::Rehash(const unsigned char new_capacity_bits)
+    {
+        std::vector<value_type> old_slots = std::move(slots);
+
+        capacity_bits = new_capacity_bits;
+        slots = std::vector<value_type>(static_cast<size_t>(1) << capacity_bits);
+        mask = slots.size() - 1;
+
+        for (size_t i = 0; i < old_slots.size(); ++i)
+        {
+            if (old_slots[i].second != nullptr)
+            {
+                slots[FindSlot(old_slots[i].first.first, old_slots[i].first.second)] = std::move(old_slots[i]);
+            }
+        }
+    }
+} // Botcraft
@@ -0,0 +1,282 @@
+#include "botcraft/Game/World/RegionCache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+using namespace ProtocolCraft;
+
+namespace Botcraft
+{
+    static const char REGION_MAGIC[4] = { 'B', 'C', 'R', 'C' };
+    static const int REGION_FORMAT_VERSION = 2;
+    static const int NUM_REGION_ENTRIES = RegionCache::REGION_WIDTH * RegionCache::REGION_WIDTH;
+    // Magic, format version, protocol version, reserved
+    static const int ENTRIES_OFFSET = 16;
+    // Sector and size of each chunk
+    static const int HEADER_SIZE = ENTRIES_OFFSET + NUM_REGION_ENTRIES * 8;
+    static const unsigned int HEADER_SECTORS = (HEADER_SIZE + RegionCache::SECTOR_SIZE - 1) / RegionCache::SECTOR_SIZE;
+
+    static inline int GetRegionEntryIndex(const int x, const int z)
+    {
+        return (x & (RegionCache::REGION_WIDTH - 1)) + RegionCache::REGION_WIDTH * (z & (RegionCache::REGION_WIDTH - 1));
+    }
+
+    RegionCache::RegionCache(const std::string& folder_, const size_t max_loaded_chunks_)
+    {
+        folder = folder_;
+        max_loaded_chunks = max_loaded_chunks_;
+    }
+
+    void RegionCache::Save(const int x, const int z, const std::shared_ptr<const Chunk>& chunk)
+    {
+        if (chunk == nullptr)
+        {
+            return;
+        }
+
+        // Serialization is done before locking
+        std::vector<unsigned char> chunk_data;
+        chunk->Serialize(chunk_data);
+        const unsigned int chunk_size = static_cast<unsigned int>(chunk_data.size());
+        const unsigned int chunk_sectors = (chunk_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        // Keep the file size a multiple of SECTOR_SIZE
+        chunk_data.resize(static_cast<size_t>(chunk_sectors) * SECTOR_SIZE, 0);
+
+        const std::string dimension = GetDimensionName(chunk->GetDimension());
+
+        std::lock_guard<std::mutex> cache_guard(mutex);
+        Region& region = GetRegion(dimension, x, z);
+        // The file will be mapped again with its new size on next load
+        region.file.Close();
+
+        if (!region.valid)
+        {
+            WriteContainer header;
+            header.insert(header.end(), REGION_MAGIC, REGION_MAGIC + 4);
+            WriteData<int>(REGION_FORMAT_VERSION, header);
+            WriteData<int>(PROTOCOL_VERSION, header);
+            WriteData<int>(0, header);
+            header.resize(static_cast<size_t>(HEADER_SECTORS) * SECTOR_SIZE, 0);
+
+            std::ofstream new_file(region.path, std::ios::out | std::ios::binary | std::ios::trunc);
+            new_file.write(reinterpret_cast<const char*>(header.data()), header.size());
+            if (!new_file)
+            {
+                std::cerr << "Error, can't create region file " << region.path << std::endl;
+                return;
+            }
+
+            region.entries = std::vector<std::pair<unsigned int, unsigned int> >(NUM_REGION_ENTRIES, { 0, 0 });
+            region.num_sectors = HEADER_SECTORS;
+            region.valid = true;
+        }
+
+        std::fstream file(region.path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Error, can't open region file " << region.path << std::endl;
+            return;
+        }
+
+        // The chunk is written in place if it's not bigger than the previous
+        // version, otherwise at the end of the file. The space used by the
+        // previous version is then lost until the file is recreated
+        const int index = GetRegionEntryIndex(x, z);
+        std::pair<unsigned int, unsigned int>& entry = region.entries[index];
+        unsigned int sector = entry.first;
+        if (sector == 0 || chunk_sectors > (entry.second + SECTOR_SIZE - 1) / SECTOR_SIZE)
+        {
+            sector = region.num_sectors;
+            region.num_sectors += chunk_sectors;
+        }
+
+        file.seekp(static_cast<std::streamoff>(sector) * SECTOR_SIZE);
+        file.write(reinterpret_cast<const char*>(chunk_data.data()), chunk_data.size());
+
+        WriteContainer entry_data;
+        WriteData<unsigned int>(sector, entry_data);
+        WriteData<unsigned int>(chunk_size, entry_data);
+        file.seekp(ENTRIES_OFFSET + 8 * index);
+        file.write(reinterpret_cast<const char*>(entry_data.data()), entry_data.size());
+
+        if (!file)
+        {
+            std::cerr << "Error writing chunk " << x << ", " << z << " in region file " << region.path << std::endl;
+            // Don't trust the content of this file anymore
+            region.valid = false;
+            return;
+        }
+
+        entry = { sector, chunk_size };
+        KeepLoaded(ChunkKey(dimension, x, z), chunk);
+    }
+
+#if PROTOCOL_VERSION < 719
+    std::shared_ptr<const Chunk> RegionCache::Load(const Dimension dimension, const int x, const int z, const WorldLayers& layers)
+#else
+    std::shared_ptr<const Chunk> RegionCache::Load(const std::string& dimension, const int x, const int z, const WorldLayers& layers)
+#endif
+    {
+        const ChunkKey key(GetDimensionName(dimension), x, z);
+
+        std::vector<unsigned char> chunk_data;
+        {
+            std::lock_guard<std::mutex> cache_guard(mutex);
+            auto it = loaded_chunks_index.find(key);
+            if (it != loaded_chunks_index.end())
+            {
+                loaded_chunks.splice(loaded_chunks.begin(), loaded_chunks, it->second);
+                return it->second->second;
+            }
+
+            Region& region = GetRegion(std::get<0>(key), x, z);
+            if (!region.valid)
+            {
+                return nullptr;
+            }
+
+            const std::pair<unsigned int, unsigned int>& entry = region.entries[GetRegionEntryIndex(x, z)];
+            if (entry.first == 0)
+            {
+                return nullptr;
+            }
+
+            if (!region.file.IsOpen() && !region.file.Open(region.path))
+            {
+                return nullptr;
+            }
+
+            const size_t offset = static_cast<size_t>(entry.first) * SECTOR_SIZE;
+            if (region.file.GetData() == nullptr || offset + entry.second > region.file.GetSize())
+            {
+                return nullptr;
+            }
+
+            // Copy the data so the mapping can be closed
+            // by a save while the chunk is deserialized
+            chunk_data = std::vector<unsigned char>(region.file.GetData() + offset, region.file.GetData() + offset + entry.second);
+        }
+
+        std::shared_ptr<Chunk> chunk;
+        try
+        {
+            ReadIterator iter = chunk_data.begin();
+            size_t length = chunk_data.size();
+            chunk = Chunk::Deserialize(iter, length, dimension, layers);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error loading chunk " << x << ", " << z << " from the cache: " << e.what() << std::endl;
+            return nullptr;
+        }
+        // Identical sections are shared with all the other chunks
+        chunk->InternSections();
+
+        std::lock_guard<std::mutex> cache_guard(mutex);
+        KeepLoaded(key, chunk);
+        return chunk;
+    }
+
+    RegionCache::Region& RegionCache::GetRegion(const std::string& dimension, const int x, const int z)
+    {
+        // Round toward -infinity
+        const int region_x = (x >= 0 ? x : x - REGION_WIDTH + 1) / REGION_WIDTH;
+        const int region_z = (z >= 0 ? z : z - REGION_WIDTH + 1) / REGION_WIDTH;
+
+        Region& region = regions[std::make_tuple(dimension, region_x, region_z)];
+        if (!region.path.empty())
+        {
+            return region;
+        }
+
+        region.path = folder + "/" + dimension + ".r." + std::to_string(region_x) + "." + std::to_string(region_z) + ".bcr";
+        region.entries = std::vector<std::pair<unsigned int, unsigned int> >(NUM_REGION_ENTRIES, { 0, 0 });
+        region.num_sectors = HEADER_SECTORS;
+        region.valid = false;
+
+        if (!region.file.Open(region.path))
+        {
+            return region;
+        }
+
+        if (region.file.GetSize() >= static_cast<size_t>(HEADER_SECTORS) * SECTOR_SIZE &&
+            std::memcmp(region.file.GetData(), REGION_MAGIC, 4) == 0)
+        {
+            const std::vector<unsigned char> header(region.file.GetData() + 4, region.file.GetData() + HEADER_SIZE);
+            ReadIterator iter = header.begin();
+            size_t length = header.size();
+
+            const int format_version = ReadData<int>(iter, length);
+            const int protocol_version = ReadData<int>(iter, length);
+            ReadData<int>(iter, length);
+
+            // Files from other versions are replaced, as the blockstates ids are not the same
+            if (format_version == REGION_FORMAT_VERSION && protocol_version == PROTOCOL_VERSION)
+            {
+                region.num_sectors = static_cast<unsigned int>((region.file.GetSize() + SECTOR_SIZE - 1) / SECTOR_SIZE);
+                for (int i = 0; i < NUM_REGION_ENTRIES; ++i)
+                {
+                    const unsigned int sector = ReadData<unsigned int>(iter, length);
+                    const unsigned int size = ReadData<unsigned int>(iter, length);
+                    // Ignore entries pointing outside of the file
+                    if (sector >= HEADER_SECTORS && sector + (size + SECTOR_SIZE - 1) / SECTOR_SIZE <= region.num_sectors)
+                    {
+                        region.entries[i] = { sector, size };
+                    }
+                }
+                region.valid = true;
+            }
+        }
+
+        if (!region.valid)
+        {
+            std::cerr << "Warning, region file " << region.path << " is not valid and will be replaced" << std::endl;
+            region.file.Close();
+        }
+
+        return region;
+    }
+
+    void RegionCache::KeepLoaded(const ChunkKey& key, const std::shared_ptr<const Chunk>& chunk)
+    {
+        auto it = loaded_chunks_index.find(key);
+        if (it != loaded_chunks_index.end())
+        {
+            it->second->second = chunk;
+            loaded_chunks.splice(loaded_chunks.begin(), loaded_chunks, it->second);
+            return;
+        }
+
+        loaded_chunks.emplace_front(key, chunk);
+        loaded_chunks_index[key] = loaded_chunks.begin();
+
+        while (loaded_chunks.size() > max_loaded_chunks)
+        {
+            loaded_chunks_index.erase(loaded_chunks.back().first);
+            loaded_chunks.pop_back();
+        }
+    }
+
+#if PROTOCOL_VERSION < 719
+    const std::string RegionCache::GetDimensionName(const Dimension dimension)
+    {
+        return "dim" + std::to_string(static_cast<int>(dimension));
+    }
+#else
+    const std::string RegionCache::GetDimensionName(const std::string& dimension)
+    {
+        // Replace the characters that can't be used in file names (minecraft:overworld)
+        std::string output = dimension;
+        for (int i = 0; i < output.size(); ++i)
+        {
+            const char c = output[i];
+            if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_'))
+            {
+                output[i] = '_';
+            }
+        }
+        return output;
+    }
+#endif
+} // Botcraft
@@ -0,0 +1,613 @@
+#include "botcraft/Game/World/Section.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using namespace ProtocolCraft;
+
+namespace Botcraft
+{
+    // has_sky_light is unused, sky light is always stored
+    Section::Section(const bool)
+    {
+        // A new section is filled with air
+        palette = std::deque<Block>(1);
+        bits_per_entry = 0;
+        last_palette_index = 0;
+        solid_mask.fill(0);
+        fluid_mask.fill(0);
+        non_air_count = 0;
+
+        // Sky light is only read in dimensions with sky
+        // light, so both can start with the same array
+        block_light = GetUniformLight(0);
+        sky_light = GetUniformLight(0);
+    }
+
+    const Block* Section::GetBlock(const int index) const
+    {
+        return &palette[GetPaletteIndex(index)];
+    }
+
+    void Section::SetBlock(const int index, const Block& block)
+    {
+        // block could be a reference to a palette element, that
+        // could be moved by FindOrAddToPalette, but blockstates can't
+        const Blockstate* old_blockstate = palette[GetPaletteIndex(index)].GetBlockstate().get();
+        const Blockstate* new_blockstate = block.GetBlockstate().get();
+
+        SetPaletteIndex(index, FindOrAddToPalette(block));
+
+        if (old_blockstate == new_blockstate)
+        {
+            return;
+        }
+
+        const unsigned long long int bit = 1ULL << (index % 64);
+        solid_mask[index / 64] = new_blockstate->IsSolid() ? (solid_mask[index / 64] | bit) : (solid_mask[index / 64] & ~bit);
+        fluid_mask[index / 64] = new_blockstate->IsFluid() ? (fluid_mask[index / 64] | bit) : (fluid_mask[index / 64] & ~bit);
+        non_air_count += (old_blockstate->IsAir() ? 1 : 0) - (new_blockstate->IsAir() ? 1 : 0);
+    }
+
+    void Section::LoadPalettedData(std::deque<Block>&& new_palette, const unsigned int* palette_indices)
+    {
+        palette = std::move(new_palette);
+        last_palette_index = 0;
+
+        if (palette.size() < 2)
+        {
+            if (palette.empty())
+            {
+                palette.push_back(Block());
+            }
+            bits_per_entry = 0;
+            data.clear();
+            ComputeOccupancy();
+            return;
+        }
+
+        bits_per_entry = palette.size() <= 16 ? 4 : (palette.size() <= 256 ? 8 : 16);
+        const int entries_per_long = 64 / bits_per_entry;
+        data = std::vector<unsigned long long int>(NUM_BLOCKS / entries_per_long, 0);
+        for (int i = 0; i < NUM_BLOCKS; ++i)
+        {
+            data[i / entries_per_long] |= static_cast<unsigned long long int>(palette_indices[i]) << ((i % entries_per_long) * bits_per_entry);
+        }
+        ComputeOccupancy();
+    }
+
+    const unsigned char Section::GetBlockLight(const int index) const
+    {
+        return ((*block_light)[index >> 1] >> ((index & 1) << 2)) & 0x0F;
+    }
+
+    void Section::SetBlockLight(const int index, const unsigned char v)
+    {
+        SetLight(block_light, index, v);
+    }
+
+    const unsigned char Section::GetSkyLight(const int index) const
+    {
+        return ((*sky_light)[index >> 1] >> ((index & 1) << 2)) & 0x0F;
+    }
+
+    void Section::SetSkyLight(const int index, const unsigned char v)
+    {
+        SetLight(sky_light, index, v);
+    }
+
+    void Section::SetBlockLightData(const char* data)
+    {
+        SetLightData(block_light, data);
+    }
+
+    void Section::SetSkyLightData(const char* data)
+    {
+        SetLightData(sky_light, data);
+    }
+
+    void Section::FillBlockLight(const unsigned char v)
+    {
+        block_light = GetUniformLight(v);
+    }
+
+    void Section::FillSkyLight(const unsigned char v)
+    {
+        sky_light = GetUniformLight(v);
+    }
+
+    const size_t Section::GetPaletteSize() const
+    {
+        return palette.size();
+    }
+
+    const unsigned char Section::GetBitsPerEntry() const
+    {
+        return bits_per_entry;
+    }
+
+    const bool Section::IsSolid(const int index) const
+    {
+        return (solid_mask[index / 64] >> (index % 64)) & 1;
+    }
+
+    const bool Section::IsFluid(const int index) const
+    {
+        return (fluid_mask[index / 64] >> (index % 64)) & 1;
+    }
+
+    const std::array<unsigned long long int, Section::NUM_BLOCKS / 64>& Section::GetSolidMask() const
+    {
+        return solid_mask;
+    }
+
+    const std::array<unsigned long long int, Section::NUM_BLOCKS / 64>& Section::GetFluidMask() const
+    {
+        return fluid_mask;
+    }
+
+    const int Section::GetNonAirCount() const
+    {
+        return non_air_count;
+    }
+
+    const std::deque<Block>& Section::GetPalette() const
+    {
+        return palette;
+    }
+
+    const unsigned int Section::GetPaletteIndex(const int index) const
+    {
+        if (bits_per_entry == 0)
+        {
+            return 0;
+        }
+
+        const int entries_per_long = 64 / bits_per_entry;
+        const unsigned long long int mask = (1ULL << bits_per_entry) - 1;
+        return static_cast<unsigned int>((data[index / entries_per_long] >> ((index % entries_per_long) * bits_per_entry)) & mask);
+    }
+
+    void Section::SetPaletteIndex(const int index, const unsigned int palette_index)
+    {
+        if (bits_per_entry == 0)
+        {
+            // FindOrAddToPalette already repacked the data
+            // if it was not the only element in the palette
+            return;
+        }
+
+        const int entries_per_long = 64 / bits_per_entry;
+        const int shift = (index % entries_per_long) * bits_per_entry;
+        const unsigned long long int mask = (1ULL << bits_per_entry) - 1;
+        unsigned long long int& value = data[index / entries_per_long];
+        value = (value & ~(mask << shift)) | (static_cast<unsigned long long int>(palette_index) << shift);
+    }
+
+    const unsigned int Section::FindOrAddToPalette(const Block& block)
+    {
+        const Block& last_block = palette[last_palette_index];
+        if (last_block.GetBlockstate() == block.GetBlockstate())
+        {
+            return last_palette_index;
+        }
+
+        for (unsigned int i = 0; i < palette.size(); ++i)
+        {
+            if (palette[i].GetBlockstate() == block.GetBlockstate())
+            {
+                last_palette_index = i;
+                return i;
+            }
+        }
+
+        // Not in the palette, we need to add it
+        if (palette.size() == (1ULL << bits_per_entry))
+        {
+            // block could be a reference to a palette element
+            const Block new_block = block;
+
+            // Remove the blocks not used anymore before
+            // using more bits per entry
+            if (bits_per_entry > 0)
+            {
+                CompactPalette();
+            }
+            if (palette.size() == (1ULL << bits_per_entry))
+            {
+                Repack(bits_per_entry == 0 ? 4 : 2 * bits_per_entry);
+            }
+            palette.push_back(new_block);
+        }
+        else
+        {
+            palette.push_back(block);
+        }
+
+        last_palette_index = static_cast<unsigned int>(palette.size() - 1);
+        return last_palette_index;
+    }
+
+    void Section::CompactPalette()
+    {
+        std::vector<unsigned int> new_indices(palette.size(), 0);
+        for (int i = 0; i < NUM_BLOCKS; ++i)
+        {
+            new_indices[GetPaletteIndex(i)] = 1;
+        }
+
+        std::deque<Block> new_palette;
+        for (unsigned int i = 0; i < palette.size(); ++i)
+        {
+            if (new_indices[i])
+            {
+                new_indices[i] = static_cast<unsigned int>(new_palette.size());
+                new_palette.push_back(palette[i]);
+            }
+        }
+
+        if (new_palette.size() == palette.size())
+        {
+            return;
+        }
+
+        for (int i = 0; i < NUM_BLOCKS; ++i)
+        {
+            SetPaletteIndex(i, new_indices[GetPaletteIndex(i)]);
+        }
+        palette = std::move(new_palette);
+        last_palette_index = 0;
+    }
+
+    const std::shared_ptr<Section::LightArray>& Section::GetUniformLight(const unsigned char v)
+    {
+        static const std::array<std::shared_ptr<LightArray>, 16> uniform_lights = []()
+        {
+            std::array<std::shared_ptr<LightArray>, 16> output;
+            for (int i = 0; i < 16; ++i)
+            {
+                output[i] = std::make_shared<LightArray>();
+                output[i]->fill(static_cast<unsigned char>(i | (i << 4)));
+            }
+            return output;
+        }();
+
+        return uniform_lights[v & 0x0F];
+    }
+
+    void Section::SetLightData(std::shared_ptr<LightArray>& light, const char* data)
+    {
+        // Full dark and full bright arrays are very common, share them
+        const unsigned char first_value = static_cast<unsigned char>(data[0]);
+        if ((first_value >> 4) == (first_value & 0x0F))
+        {
+            const std::shared_ptr<LightArray>& uniform = GetUniformLight(first_value);
+            if (std::memcmp(uniform->data(), data, LIGHT_DATA_SIZE) == 0)
+            {
+                light = uniform;
+                return;
+            }
+        }
+
+        // Shared array (uniform ones always are), don't overwrite it
+        if (light.use_count() > 1)
+        {
+            light = std::make_shared<LightArray>();
+        }
+        std::memcpy(light->data(), data, LIGHT_DATA_SIZE);
+    }
+
+    void Section::SetLight(std::shared_ptr<LightArray>& light, const int index, const unsigned char v)
+    {
+        const int shift = (index & 1) << 2;
+        unsigned char& value = (*light)[index >> 1];
+        if (((value >> shift) & 0x0F) == (v & 0x0F))
+        {
+            return;
+        }
+
+        // Shared array, make a copy before writing
+        if (light.use_count() > 1)
+        {
+            light = std::make_shared<LightArray>(*light);
+        }
+
+        unsigned char& new_value = (*light)[index >> 1];
+        new_value = (new_value & ~(0x0F << shift)) | ((v & 0x0F) << shift);
+    }
+
+    struct InternTable
+    {
+        std::mutex mutex;
+        std::unordered_map<unsigned long long int, std::vector<std::shared_ptr<Section> > > sections;
+        SectionInternStats stats;
+        // Sections only referenced by the table are
+        // removed when it reaches this size
+        size_t next_cleaning_size = 1024;
+    };
+
+    static InternTable& GetInternTable()
+    {
+        static InternTable table;
+        return table;
+    }
+
+    // FNV-1a on 64 bits words
+    static inline void HashCombine(unsigned long long int& hash, const unsigned long long int value)
+    {
+        hash ^= value;
+        hash *= 0x100000001B3ULL;
+    }
+
+    std::shared_ptr<Section> Section::Intern(const std::shared_ptr<Section>& section)
+    {
+        if (section == nullptr)
+        {
+            return section;
+        }
+
+        const unsigned long long int hash = section->GetContentHash();
+
+        InternTable& table = GetInternTable();
+        std::lock_guard<std::mutex> table_guard(table.mutex);
+        table.stats.lookups++;
+
+        std::vector<std::shared_ptr<Section> >& candidates = table.sections[hash];
+        for (int i = 0; i < candidates.size(); ++i)
+        {
+            if (candidates[i] == section)
+            {
+                return section;
+            }
+            if (candidates[i]->HasSameContent(*section))
+            {
+                table.stats.hits++;
+                return candidates[i];
+            }
+        }
+
+        candidates.push_back(section);
+        table.stats.interned++;
+
+        if (table.stats.interned >= table.next_cleaning_size)
+        {
+            // Remove the sections not used by any chunk anymore. Sections
+            // referenced only by the table can't be accessed without locking
+            // the table, so their use count can't increase in the meantime
+            for (auto it = table.sections.begin(); it != table.sections.end();)
+            {
+                std::vector<std::shared_ptr<Section> >& bucket = it->second;
+                for (int i = static_cast<int>(bucket.size()) - 1; i >= 0; --i)
+                {
+                    if (bucket[i].use_count() == 1)
+                    {
+                        bucket.erase(bucket.begin() + i);
+                        table.stats.interned--;
+                    }
+                }
+                it = bucket.empty() ? table.sections.erase(it) : std::next(it);
+            }
+            table.next_cleaning_size = std::max(static_cast<size_t>(1024), 2 * table.stats.interned);
+        }
+
+        return section;
+    }
+
+    const SectionInternStats Section::GetInternStats()
+    {
+        InternTable& table = GetInternTable();
+        std::lock_guard<std::mutex> table_guard(table.mutex);
+        return table.stats;
+    }
+
+    const unsigned long long int Section::GetContentHash() const
+    {
+        unsigned long long int hash = 0xCBF29CE484222325ULL;
+        for (int i = 0; i < palette.size(); ++i)
+        {
+            HashCombine(hash, reinterpret_cast<unsigned long long int>(palette[i].GetBlockstate().get()));
+        }
+        HashCombine(hash, bits_per_entry);
+        for (int i = 0; i < data.size(); ++i)
+        {
+            HashCombine(hash, data[i]);
+        }
+
+        // Light arrays size is a multiple of 8
+        unsigned long long int light_value;
+        for (int i = 0; i < LIGHT_DATA_SIZE; i += sizeof(unsigned long long int))
+        {
+            std::memcpy(&light_value, block_light->data() + i, sizeof(unsigned long long int));
+            HashCombine(hash, light_value);
+            std::memcpy(&light_value, sky_light->data() + i, sizeof(unsigned long long int));
+            HashCombine(hash, light_value);
+        }
+
+        return hash;
+    }
+
+    const bool Section::HasSameContent(const Section& other) const
+    {
+        if (bits_per_entry != other.bits_per_entry ||
+            palette.size() != other.palette.size() ||
+            data != other.data)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < palette.size(); ++i)
+        {
+            if (palette[i].GetBlockstate() != other.palette[i].GetBlockstate())
+            {
+                return false;
+            }
+        }
+
+        return (block_light == other.block_light || std::memcmp(block_light->data(), other.block_light->data(), LIGHT_DATA_SIZE) == 0) &&
+            (sky_light == other.sky_light || std::memcmp(sky_light->data(), other.sky_light->data(), LIGHT_DATA_SIZE) == 0);
+    }
+
+    // Light arrays with the same value for all the blocks
+    // are stored as this value only, the others are prefixed
+    // by this marker
+    static const unsigned char LIGHT_ARRAY_MARKER = 0xFF;
+
+    void Section::Serialize(WriteContainer& container) const
+    {
+        WriteData<VarInt>(static_cast<int>(palette.size()), container);
+        for (int i = 0; i < palette.size(); ++i)
+        {
+            const std::shared_ptr<Blockstate>& blockstate = palette[i].GetBlockstate();
+#if PROTOCOL_VERSION < 347
+            WriteData<VarInt>(Blockstate::IdMetadataToId(blockstate->GetId(), blockstate->GetMetadata()), container);
+#else
+            WriteData<VarInt>(blockstate->GetId(), container);
+#endif
+        }
+
+        // The size of data only depends on bits_per_entry
+        WriteData<unsigned char>(bits_per_entry, container);
+        for (int i = 0; i < data.size(); ++i)
+        {
+            WriteData<unsigned long long int>(data[i], container);
+        }
+
+        SerializeLight(block_light, container);
+        SerializeLight(sky_light, container);
+    }
+
+    void Section::Deserialize(ReadIterator& iter, size_t& length)
+    {
+        const int palette_size = ReadData<VarInt>(iter, length);
+        if (palette_size < 1 || palette_size > NUM_BLOCKS)
+        {
+            throw std::runtime_error("Invalid palette size in serialized section");
+        }
+
+        std::deque<Block> new_palette;
+        for (int i = 0; i < palette_size; ++i)
+        {
+#if PROTOCOL_VERSION < 347
+            unsigned int id;
+            unsigned char metadata;
+            Blockstate::IdToIdMetadata(ReadData<VarInt>(iter, length), id, metadata);
+            new_palette.emplace_back(id, metadata);
+#else
+            new_palette.emplace_back(static_cast<int>(ReadData<VarInt>(iter, length)));
+#endif
+        }
+
+        const unsigned char new_bits_per_entry = ReadData<unsigned char>(iter, length);
+        if ((new_bits_per_entry != 0 && new_bits_per_entry != 4 && new_bits_per_entry != 8 && new_bits_per_entry != 16) ||
+            static_cast<unsigned long long int>(palette_size) > (1ULL << new_bits_per_entry))
+        {
+            throw std::runtime_error("Invalid bits per entry in serialized section");
+        }
+
+        std::vector<unsigned long long int> new_data(new_bits_per_entry == 0 ? 0 : NUM_BLOCKS / (64 / new_bits_per_entry));
+        for (int i = 0; i < new_data.size(); ++i)
+        {
+            new_data[i] = ReadData<unsigned long long int>(iter, length);
+        }
+
+        palette = std::move(new_palette);
+        bits_per_entry = new_bits_per_entry;
+        data = std::move(new_data);
+        last_palette_index = 0;
+
+        // Indices must stay in the palette, GetBlock doesn't check them
+        if (palette.size() < (1ULL << bits_per_entry))
+        {
+            for (int i = 0; i < NUM_BLOCKS; ++i)
+            {
+                if (GetPaletteIndex(i) >= palette.size())
+                {
+                    throw std::runtime_error("Invalid palette index in serialized section");
+                }
+            }
+        }
+        ComputeOccupancy();
+
+        DeserializeLight(block_light, iter, length);
+        DeserializeLight(sky_light, iter, length);
+    }
+
+    void Section::SerializeLight(const std::shared_ptr<LightArray>& light, WriteContainer& container)
+    {
+        const unsigned char value = (*light)[0] & 0x0F;
+        if (light == GetUniformLight(value))
+        {
+            WriteData<unsigned char>(value, container);
+        }
+        else
+        {
+            WriteData<unsigned char>(LIGHT_ARRAY_MARKER, container);
+            container.insert(container.end(), light->begin(), light->end());
+        }
+    }
+
+    void Section::DeserializeLight(std::shared_ptr<LightArray>& light, ReadIterator& iter, size_t& length)
+    {
+        const unsigned char value = ReadData<unsigned char>(iter, length);
+        if (value != LIGHT_ARRAY_MARKER)
+        {
+            light = GetUniformLight(value);
+            return;
+        }
+
+        const std::vector<unsigned char> light_data = ReadByteArray(iter, length, LIGHT_DATA_SIZE);
+        SetLightData(light, reinterpret_cast<const char*>(light_data.data()));
+    }
+
+    void Section::ComputeOccupancy()
+    {
+        // Blockstate properties are only read once per palette entry
+        // bit 0: solid, bit 1: fluid, bit 2: not air
+        std::vector<unsigned char> palette_flags(palette.size());
+        for (int i = 0; i < palette.size(); ++i)
+        {
+            const Blockstate* blockstate = palette[i].GetBlockstate().get();
+            palette_flags[i] = (blockstate->IsSolid() ? 1 : 0) | (blockstate->IsFluid() ? 2 : 0) | (blockstate->IsAir() ? 0 : 4);
+        }
+
+        if (bits_per_entry == 0)
+        {
+            solid_mask.fill((palette_flags[0] & 1) ? ~0ULL : 0ULL);
+            fluid_mask.fill((palette_flags[0] & 2) ? ~0ULL : 0ULL);
+            non_air_count = (palette_flags[0] & 4) ? NUM_BLOCKS : 0;
+            return;
+        }
+
+        solid_mask.fill(0);
+        fluid_mask.fill(0);
+        non_air_count = 0;
+        for (int i = 0; i < NUM_BLOCKS; ++i)
+        {
+            const unsigned char flags = palette_flags[GetPaletteIndex(i)];
+            solid_mask[i / 64] |= static_cast<unsigned long long int>(flags & 1) << (i % 64);
+            fluid_mask[i / 64] |= static_cast<unsigned long long int>((flags >> 1) & 1) << (i % 64);
+            non_air_count += (flags >> 2) & 1;
+        }
+    }
+
+    void Section::Repack(const unsigned char new_bits_per_entry)
+    {
+        const int new_entries_per_long = 64 / new_bits_per_entry;
+        std::vector<unsigned long long int> new_data((NUM_BLOCKS + new_entries_per_long - 1) / new_entries_per_long, 0);
+
+        if (bits_per_entry != 0)
+        {
+            for (int i = 0; i < NUM_BLOCKS; ++i)
+            {
+                new_data[i / new_entries_per_long] |= static_cast<unsigned long long int>(GetPaletteIndex(i)) << ((i % new_entries_per_long) * new_bits_per_entry);
+            }
+        }
+
+        bits_per_entry = new_bits_per_entry;
+        data = std::move(new_data);
+    }
+} // Botcraft
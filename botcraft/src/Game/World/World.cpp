@@ -1,20 +1,37 @@
 #include "botcraft/Game/World/World.hpp"
 #include "botcraft/Game/World/Chunk.hpp"
 #include "botcraft/Game/World/Block.hpp"
+#include "botcraft/Game/World/Blockstate.hpp"
+#include "botcraft/Game/World/Section.hpp"
+#include "botcraft/Game/World/RegionCache.hpp"
 #include "botcraft/Game/Enums.hpp"
+#include "botcraft/Game/AssetsManager.hpp"
 #include "botcraft/Utilities/AsyncHandler.hpp"
+#include "botcraft/Utilities/MappedFile.hpp"
 
 #include "protocolCraft/Types/NBT/NBT.hpp"
 #include "protocolCraft/Types/NBT/TagInt.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
 
 namespace Botcraft
 {
-    World::World(const bool is_shared_, const bool async_handler_)
+    World::World(const bool is_shared_, const bool async_handler_, const WorldLayers& layers_, const int decoding_threads_,
+        const std::string& cache_folder_)
     {
         is_shared = is_shared_;
+        layers = layers_;
+        chunk_sequence = 0;
+        next_client_id = 0;
+        version = 0;
+        recording_changes = false;
+        next_subscriber_id = 0;
+        delivering_changes = false;
 
 #if PROTOCOL_VERSION < 719
         current_dimension = Dimension::None;
@@ -29,14 +46,46 @@ namespace Botcraft
         {
             async_handler = nullptr;
         }
+
+        if (!cache_folder_.empty())
+        {
+            region_cache = std::unique_ptr<RegionCache>(new RegionCache(cache_folder_));
+        }
+
+        decoding = true;
+        for (int i = 0; i < decoding_threads_; ++i)
+        {
+            decoding_threads.push_back(std::thread(&World::ProcessChunkDecoding, this));
+        }
     }
 
     World::~World()
     {
+        {
+            std::lock_guard<std::mutex> decoding_guard(decoding_mutex);
+            decoding = false;
+        }
+        decoding_condition_variable.notify_all();
 
+        for (int i = 0; i < decoding_threads.size(); ++i)
+        {
+            if (decoding_threads[i].joinable())
+            {
+                decoding_threads[i].join();
+            }
+        }
+
+        // Keep all the chunks for next time
+        if (region_cache != nullptr)
+        {
+            for (auto it = terrain.begin(); it != terrain.end(); ++it)
+            {
+                region_cache->Save(it->first.first, it->first.second, it->second);
+            }
+        }
     }
 
-    std::mutex& World::GetMutex()
+    std::shared_mutex& World::GetMutex()
     {
         return world_mutex;
     }
@@ -46,6 +95,11 @@ namespace Botcraft
         return is_shared;
     }
 
+    const WorldLayers& World::GetLayers() const
+    {
+        return layers;
+    }
+
     ProtocolCraft::Handler* World::GetAsyncHandler()
     {
         if (async_handler != nullptr)
@@ -69,19 +123,21 @@ namespace Botcraft
         if (!chunk)
         {
 #if PROTOCOL_VERSION < 757
-            terrain[{x, z}] = std::make_shared<Chunk>(dim);
+            terrain.insert_or_assign({ x, z }, std::make_shared<Chunk>(dim, layers));
 #else
-            terrain[{x, z}] = std::make_shared<Chunk>(dimension_min_y[dim], dimension_height[dim], dim);
+            terrain.insert_or_assign({ x, z }, std::make_shared<Chunk>(dimension_min_y[dim], dimension_height[dim], dim, layers));
 #endif
+            RecordChange(WorldChange::Type::ChunkLoaded, x, z);
         }
         else if (chunk->GetDimension() != dim)
         {
             RemoveChunk(x, z);
 #if PROTOCOL_VERSION < 757
-            terrain[{x, z}] = std::make_shared<Chunk>(dim);
+            terrain.insert_or_assign({ x, z }, std::make_shared<Chunk>(dim, layers));
 #else
-            terrain[{x, z}] = std::make_shared<Chunk>(dimension_min_y[dim], dimension_height[dim], dim);
+            terrain.insert_or_assign({ x, z }, std::make_shared<Chunk>(dimension_min_y[dim], dimension_height[dim], dim, layers));
 #endif
+            RecordChange(WorldChange::Type::ChunkLoaded, x, z);
         }
         
         //Not necessary, from void to air, there is no difference
@@ -92,14 +148,13 @@ namespace Botcraft
 
     bool World::RemoveChunk(const int x, const int z)
     {
-        std::map<std::pair<int, int>, std::shared_ptr<Chunk> >::iterator it = terrain.find({ x, z });
-        if (it != terrain.end())
+        if (terrain.erase({ x, z }) > 0)
         {
-            terrain.erase(it);
+            RecordChange(WorldChange::Type::ChunkUnloaded, x, z);
 
-            if (cached && cached_x == x && cached_z == z)
+            for (auto index_it = block_indices.begin(); index_it != block_indices.end(); ++index_it)
             {
-                cached = nullptr;
+                index_it->second.positions.erase({ x, z });
             }
 
             UpdateChunk(x, z);
@@ -112,7 +167,7 @@ namespace Botcraft
 #if USE_GUI
     const bool World::HasChunkBeenModified(const int x, const int z)
     {
-        std::shared_ptr<Chunk> chunk = GetChunk(x, z);
+        const Chunk* chunk = GetChunkForReading(x, z);
         if (chunk == nullptr)
         {
             return true;
@@ -154,7 +209,34 @@ namespace Botcraft
 #else
             chunk->LoadChunkData(data);
 #endif
+            chunk->ComputeHeightmaps();
+            IndexChunk(x, z);
             UpdateChunk(x, z);
+
+#if PROTOCOL_VERSION < 552
+            if (ground_up_continuous)
+            {
+                RecordChange(WorldChange::Type::ChunkLoaded, x, z);
+                return true;
+            }
+#endif
+#if PROTOCOL_VERSION < 757
+            // Only the sections in the mask have been replaced
+            for (int i = 0; i < chunk->GetHeight() / SECTION_HEIGHT; ++i)
+            {
+#if PROTOCOL_VERSION < 755
+                const bool in_mask = (primary_bit_mask >> i) & 1;
+#else
+                const bool in_mask = i / 64 < primary_bit_mask.size() && ((primary_bit_mask[i / 64] >> (i % 64)) & 1);
+#endif
+                if (in_mask)
+                {
+                    RecordChange(WorldChange::Type::SectionReplaced, x, z, Position(x * CHUNK_WIDTH, chunk->GetMinY() + i * SECTION_HEIGHT, z * CHUNK_WIDTH));
+                }
+            }
+#else
+            RecordChange(WorldChange::Type::ChunkLoaded, x, z);
+#endif
             return true;
         }
         return false;
@@ -170,7 +252,6 @@ namespace Botcraft
         if (chunk)
         {
             chunk->LoadChunkBlockEntitiesData(block_entities);
-            UpdateChunk(x, z);
             return true;
         }
         return false;
@@ -183,7 +264,6 @@ namespace Botcraft
         if (chunk)
         {
             chunk->SetBiomes(biomes);
-            UpdateChunk(x, z);
             return true;
         }
         return false;
@@ -191,38 +271,47 @@ namespace Botcraft
 #endif
 
 #if PROTOCOL_VERSION < 347
-    bool World::SetBlock(const Position &pos, const unsigned int id, unsigned char metadata, const int model_id)
+    bool World::SetBlock(const Position &pos, const unsigned int id, unsigned char metadata)
 #else
-    bool World::SetBlock(const Position &pos, const unsigned int id, const int model_id)
+    bool World::SetBlock(const Position &pos, const unsigned int id)
 #endif
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        Chunk* chunk = terrain.Get(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
+            return false;
+        }
+
+        const int in_chunk_x = pos.x & (CHUNK_WIDTH - 1);
+        const int in_chunk_z = pos.z & (CHUNK_WIDTH - 1);
+        const Position in_chunk_pos(in_chunk_x, pos.y, in_chunk_z);
 
-            if (it != terrain.end())
+        const bool track_blockstates = !block_indices.empty() || recording_changes;
+        const Block* old_block = track_blockstates ? chunk->GetBlock(in_chunk_pos) : nullptr;
+        const Blockstate* old_blockstate = old_block ? old_block->GetBlockstate().get() : nullptr;
+#if PROTOCOL_VERSION < 347
+        chunk->SetBlock(in_chunk_pos, id, metadata);
+#else
+        chunk->SetBlock(in_chunk_pos, id);
+#endif
+        if (track_blockstates)
+        {
+            const Block* new_block = chunk->GetBlock(in_chunk_pos);
+            const Blockstate* new_blockstate = new_block ? new_block->GetBlockstate().get() : nullptr;
+            if (!block_indices.empty())
             {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
+                UpdateBlockIndices(pos, old_blockstate, new_blockstate);
             }
-            else
+            // The server often sends blocks that didn't change
+            if (old_blockstate != new_blockstate)
             {
-                return false;
+                RecordChange(WorldChange::Type::BlockChanged, chunk_x, chunk_z, pos, old_blockstate, new_blockstate);
             }
         }
 
-        const int in_chunk_x = (pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH;
-        const int in_chunk_z = (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH;
-#if PROTOCOL_VERSION < 347
-        cached->SetBlock(Position(in_chunk_x, pos.y, in_chunk_z), id, metadata, model_id);
-#else
-        cached->SetBlock(Position(in_chunk_x, pos.y, in_chunk_z), id, model_id);
-#endif
-
         if (in_chunk_x > 0 && in_chunk_x < CHUNK_WIDTH - 1 &&
             in_chunk_z > 0 && in_chunk_z < CHUNK_WIDTH - 1)
         {
@@ -253,35 +342,50 @@ namespace Botcraft
         return true;
     }
 
-    bool World::SetBlockEntityData(const Position &pos, const ProtocolCraft::NBT& data)
+    void World::ApplyBlockBatch(const std::vector<std::pair<Position, unsigned int> >& blocks)
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        // Group the blocks by chunk, keeping their order
+        std::map<std::pair<int, int>, std::vector<std::pair<Position, unsigned int> > > chunks_blocks;
+        for (int i = 0; i < blocks.size(); ++i)
+        {
+            chunks_blocks[{ blocks[i].first.x >> CHUNK_WIDTH_BITS, blocks[i].first.z >> CHUNK_WIDTH_BITS }].push_back(blocks[i]);
+        }
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        for (auto it = chunks_blocks.begin(); it != chunks_blocks.end(); ++it)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
+            const int x = it->first.first;
+            const int z = it->first.second;
+            ApplyOrDefer(x, z, [this, x, z, chunk_blocks = std::move(it->second)]() { ApplyChunkBlockBatch(x, z, chunk_blocks); });
+        }
+    }
 
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-            }
-            else
-            {
-                return false;
-            }
+#if PROTOCOL_VERSION < 757
+    bool World::SetBlockEntityData(const Position &pos, const ProtocolCraft::NBT& data)
+#else
+    bool World::SetBlockEntityData(const Position &pos, const ProtocolCraft::NBT& data, const int type)
+#endif
+    {
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
+
+        Chunk* chunk = terrain.Get(chunk_x, chunk_z);
+        if (chunk == nullptr)
+        {
+            return false;
         }
 
-        const Position chunk_pos((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH);
+        const Position chunk_pos(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1));
         if (data.HasData())
         {
-            cached->SetBlockEntityData(chunk_pos, data);
+#if PROTOCOL_VERSION < 757
+            chunk->SetBlockEntityData(chunk_pos, data);
+#else
+            chunk->SetBlockEntityData(chunk_pos, data, type);
+#endif
         }
         else
         {
-            cached->RemoveBlockEntityData(chunk_pos);
+            chunk->RemoveBlockEntityData(chunk_pos);
         }
         UpdateChunk(chunk_x, chunk_z, chunk_pos);
 
@@ -291,11 +395,11 @@ namespace Botcraft
 #if PROTOCOL_VERSION < 358
     bool World::SetBiome(const int x, const int z, const unsigned char biome)
 	{
-		auto it = terrain.find({ floor(x / (double)CHUNK_WIDTH), floor(z / (double)CHUNK_WIDTH) });
+		auto it = terrain.find({ x >> CHUNK_WIDTH_BITS, z >> CHUNK_WIDTH_BITS });
 
 		if (it != terrain.end())
 		{
-			it->second->SetBiome((x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, (z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, biome);
+			it->second->SetBiome(x & (CHUNK_WIDTH - 1), z & (CHUNK_WIDTH - 1), biome);
 			return true;
 		}
 
@@ -304,11 +408,11 @@ namespace Botcraft
 #elif PROTOCOL_VERSION < 552
 	bool World::SetBiome(const int x, const int z, const int biome)
 	{
-		auto it = terrain.find({ floor(x / (double)CHUNK_WIDTH), floor(z / (double)CHUNK_WIDTH) });
+		auto it = terrain.find({ x >> CHUNK_WIDTH_BITS, z >> CHUNK_WIDTH_BITS });
 
 		if (it != terrain.end())
 		{
-			it->second->SetBiome((x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, (z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, biome);
+			it->second->SetBiome(x & (CHUNK_WIDTH - 1), z & (CHUNK_WIDTH - 1), biome);
 			return true;
 		}
 
@@ -317,11 +421,11 @@ namespace Botcraft
 #else
 	bool World::SetBiome(const int x, const int y, const int z, const int biome)
     {
-        auto it = terrain.find({ floor(x / (double)CHUNK_WIDTH), floor(z / (double)CHUNK_WIDTH) });
+        auto it = terrain.find({ x >> CHUNK_WIDTH_BITS, z >> CHUNK_WIDTH_BITS });
 
         if (it != terrain.end())
         {
-            it->second->SetBiome((x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, y, (z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, biome);
+            it->second->SetBiome(x & (CHUNK_WIDTH - 1), y, z & (CHUNK_WIDTH - 1), biome);
             return true;
         }
 
@@ -331,7 +435,7 @@ namespace Botcraft
 
     bool World::SetSkyLight(const Position &pos, const unsigned char skylight)
     {
-        auto it = terrain.find({ floor(pos.x / (double)CHUNK_WIDTH), floor(pos.z / (double)CHUNK_WIDTH) });
+        auto it = terrain.find({ pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS });
 
         if (it != terrain.end() &&
 #if PROTOCOL_VERSION < 719
@@ -340,7 +444,7 @@ namespace Botcraft
             it->second->GetDimension() == "minecraft:overworld")
 #endif
         {
-            it->second->SetSkyLight(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH), skylight);
+            it->second->SetSkyLight(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)), skylight);
             return true;
         }
 
@@ -349,11 +453,11 @@ namespace Botcraft
 
     bool World::SetBlockLight(const Position &pos, const unsigned char blocklight)
     {
-        auto it = terrain.find({ floor(pos.x / (double)CHUNK_WIDTH), floor(pos.z / (double)CHUNK_WIDTH) });
+        auto it = terrain.find({ pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS });
 
         if (it != terrain.end())
         {
-            it->second->SetBlockLight(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH), blocklight);
+            it->second->SetBlockLight(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)), blocklight);
             return true;
         }
 
@@ -381,187 +485,55 @@ namespace Botcraft
             chunk = GetChunk(x, z);
         }
 
-        int counter_arrays = 0;
-        Position pos1, pos2;
-
-        const int num_sections = GetHeight() / 16 + 2;
-
-        for (int i = 0; i < num_sections; ++i)
-        {
-            const int section_Y = i - 1;
-
-            // Sky light
-#if PROTOCOL_VERSION < 755
-            if ((light_mask >> i) & 1)
-#else
-            if ((light_mask.size() > i / 64) && (light_mask[i / 64] >> (i % 64)) & 1)
-#endif
-            {
-                if (i > 0 && i < num_sections - 1)
-                {
-                    for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
-                    {
-                        pos1.y = block_y + section_Y * SECTION_HEIGHT + GetMinY();
-                        pos2.y = pos1.y;
-                        for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                        {
-                            pos1.z = block_z;
-                            pos2.z = block_z;
-                            for (int block_x = 0; block_x < CHUNK_WIDTH; block_x += 2)
-                            {
-                                pos1.x = block_x;
-                                pos2.x = block_x + 1;
-                                const char two_light_values = data[counter_arrays][(block_y * CHUNK_WIDTH * CHUNK_WIDTH + block_z * CHUNK_WIDTH + block_x) / 2];
-
-                                if (sky)
-                                {
-                                    chunk->SetSkyLight(pos1, two_light_values & 0x0F);
-                                    chunk->SetSkyLight(pos2, (two_light_values >> 4) & 0x0F);
-                                }
-                                else
-                                {
-                                    chunk->SetBlockLight(pos1, two_light_values & 0x0F);
-                                    chunk->SetBlockLight(pos2, (two_light_values >> 4) & 0x0F);
-                                }
-                            }
-                        }
-                    }
-                }
-                counter_arrays++;
-            }
-#if PROTOCOL_VERSION < 755
-            else if ((empty_light_mask >> i) & 1)
-#else
-            else if ((empty_light_mask.size() > i / 64) && (empty_light_mask[i / 64] >> (i % 64)) & 1)
-#endif
-            {
-                if (i > 0 && i < num_sections - 1)
-                {
-                    for (int block_y = 0; block_y < SECTION_HEIGHT; ++block_y)
-                    {
-                        pos1.y = block_y + section_Y * SECTION_HEIGHT + GetMinY();
-                        pos2.y = pos1.y;
-                        for (int block_z = 0; block_z < CHUNK_WIDTH; ++block_z)
-                        {
-                            pos1.z = block_z;
-                            pos2.z = block_z;
-                            for (int block_x = 0; block_x < CHUNK_WIDTH; block_x += 2)
-                            {
-                                pos1.x = block_x;
-                                pos2.x = block_x + 1;
-                                if (sky)
-                                {
-                                    chunk->SetSkyLight(pos1, 0);
-                                    chunk->SetSkyLight(pos2, 0);
-                                }
-                                else
-                                {
-                                    chunk->SetBlockLight(pos1, 0);
-                                    chunk->SetBlockLight(pos2, 0);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        chunk->LoadLightData(light_mask, empty_light_mask, data, sky);
     }
 
 #endif
 
+#if USE_GUI
     void World::UpdateChunk(const int x, const int z, const Position& pos)
     {
-        std::shared_ptr<Chunk> chunk = GetChunk(x, z);
-        if (pos == Position())
-        {
-            if (chunk)
-            {
-                chunk->UpdateNeighbour(GetChunk(x - 1, z), Orientation::West);
-                chunk->UpdateNeighbour(GetChunk(x + 1, z), Orientation::East);
-                chunk->UpdateNeighbour(GetChunk(x, z - 1), Orientation::North);
-                chunk->UpdateNeighbour(GetChunk(x, z + 1), Orientation::South);
-            }
-            else
-            {
-                std::shared_ptr<Chunk> neighbour_chunk;
-                neighbour_chunk = GetChunk(x - 1, z);
-                if (neighbour_chunk)
-                {
-                    neighbour_chunk->UpdateNeighbour(nullptr, Orientation::East);
-                }
-                neighbour_chunk = GetChunk(x + 1, z);
-                if (neighbour_chunk)
-                {
-                    neighbour_chunk->UpdateNeighbour(nullptr, Orientation::West);
-                }
-                neighbour_chunk = GetChunk(x, z - 1);
-                if (neighbour_chunk)
-                {
-                    neighbour_chunk->UpdateNeighbour(nullptr, Orientation::South);
-                }
-                neighbour_chunk = GetChunk(x, z + 1);
-                if (neighbour_chunk)
-                {
-                    neighbour_chunk->UpdateNeighbour(nullptr, Orientation::North);
-                }
-            }
-            return;
-        }
-        
-        if (pos.x == -1)
+        // Blocks on the border are used to know which faces of the
+        // neighbours are visible, so they have to be rendered again
+        std::shared_ptr<Chunk> neighbour_chunk;
+        if (pos.x == -1 || pos == Position())
         {
-            std::shared_ptr<Chunk> neighbour_chunk = GetChunk(x - 1, z);
-            if (chunk)
+            neighbour_chunk = GetChunk(x - 1, z);
+            if (neighbour_chunk)
             {
-                chunk->UpdateNeighbour(neighbour_chunk, Orientation::West);
-            }
-            else if (neighbour_chunk)
-            {
-                neighbour_chunk->UpdateNeighbour(nullptr, Orientation::East);
+                neighbour_chunk->SetModifiedSinceLastRender(true);
             }
         }
-        else if (pos.x == 1)
+        if (pos.x == 1 || pos == Position())
         {
-            std::shared_ptr<Chunk> neighbour_chunk = GetChunk(x + 1, z);
-            if (chunk)
-            {
-                chunk->UpdateNeighbour(neighbour_chunk, Orientation::East);
-            }
-            else if (neighbour_chunk)
+            neighbour_chunk = GetChunk(x + 1, z);
+            if (neighbour_chunk)
             {
-                neighbour_chunk->UpdateNeighbour(nullptr, Orientation::West);
+                neighbour_chunk->SetModifiedSinceLastRender(true);
             }
         }
-
-        if (pos.z == -1)
+        if (pos.z == -1 || pos == Position())
         {
-            std::shared_ptr<Chunk> neighbour_chunk = GetChunk(x, z - 1);
-            if (chunk)
-            {
-                chunk->UpdateNeighbour(neighbour_chunk, Orientation::North);
-            }
-            else if (neighbour_chunk)
+            neighbour_chunk = GetChunk(x, z - 1);
+            if (neighbour_chunk)
             {
-                neighbour_chunk->UpdateNeighbour(nullptr, Orientation::South);
+                neighbour_chunk->SetModifiedSinceLastRender(true);
             }
         }
-        else if (pos.z == 1)
+        if (pos.z == 1 || pos == Position())
         {
-            std::shared_ptr<Chunk> neighbour_chunk = GetChunk(x, z + 1);
-            if (chunk)
-            {
-                chunk->UpdateNeighbour(neighbour_chunk, Orientation::South);
-            }
-            else if (neighbour_chunk)
+            neighbour_chunk = GetChunk(x, z + 1);
+            if (neighbour_chunk)
             {
-                neighbour_chunk->UpdateNeighbour(nullptr, Orientation::North);
+                neighbour_chunk->SetModifiedSinceLastRender(true);
             }
         }
     }
+#endif
 
     const std::shared_ptr<const Chunk> World::GetChunkCopy(const int x, const int z)
     {
-        std::shared_ptr<Chunk> chunk = GetChunk(x, z);
+        const Chunk* chunk = GetChunkForReading(x, z);
         if (chunk == nullptr)
         {
             return nullptr;
@@ -570,35 +542,65 @@ namespace Botcraft
         return std::shared_ptr<const Chunk>(new Chunk(*chunk));
     }
 
+    const std::shared_ptr<const Chunk> World::GetCachedChunk(const int x, const int z)
+    {
+        const Chunk* chunk = GetChunkForReading(x, z);
+        if (chunk != nullptr)
+        {
+            return std::shared_ptr<const Chunk>(new Chunk(*chunk));
+        }
+
+        if (region_cache == nullptr)
+        {
+            return nullptr;
+        }
+
+        return region_cache->Load(current_dimension, x, z, layers);
+    }
+
     const Block* World::GetBlock(const Position &pos)
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
+            return nullptr;
+        }
 
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-            }
-            else
-            {
-                return nullptr;
-            }
+        return chunk->GetBlock(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
+    }
+
+    const int World::GetHighestBlock(const int x, const int z, const Heightmap heightmap)
+    {
+        const Chunk* chunk = GetChunkForReading(x >> CHUNK_WIDTH_BITS, z >> CHUNK_WIDTH_BITS);
+        if (chunk == nullptr)
+        {
+            return GetMinY() - 1;
         }
-        return cached->GetBlock(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH));
+
+        return chunk->GetHighestBlock(x & (CHUNK_WIDTH - 1), z & (CHUNK_WIDTH - 1), heightmap);
     }
 
     const bool World::IsLoaded(const Position& pos) const
     {
-        const int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        const int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
+
+        return GetChunkForReading(chunk_x, chunk_z) != nullptr;
+    }
+
+    const bool World::IsSolid(const Position& pos) const
+    {
+        const Chunk* chunk = GetChunkForReading(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS);
+        return chunk != nullptr && chunk->IsSolid(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
+    }
 
-        return terrain.find({ chunk_x, chunk_z }) != terrain.end();
+    const bool World::IsFluid(const Position& pos) const
+    {
+        const Chunk* chunk = GetChunkForReading(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS);
+        return chunk != nullptr && chunk->IsFluid(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
     }
 
     const int World::GetHeight() const
@@ -619,30 +621,18 @@ namespace Botcraft
 #endif
     }
 
-    std::shared_ptr<ProtocolCraft::NBT> World::GetBlockEntityData(const Position &pos)
+    std::shared_ptr<const ProtocolCraft::NBT> World::GetBlockEntityData(const Position &pos)
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (cached && cached_x == chunk_x && cached_z == chunk_z)
-        {
-            return cached->GetBlockEntityData(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH));
-        }
-        else
+        const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
-
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-
-                return cached->GetBlockEntityData(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH));
-            }
+            return nullptr;
         }
 
-        return nullptr;
+        return chunk->GetBlockEntityData(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
     }
 
 #if PROTOCOL_VERSION < 358
@@ -651,77 +641,47 @@ namespace Botcraft
     const int World::GetBiome(const Position &pos)
 #endif
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
-
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-            }
-            else
-            {
-                return 0;
-            }
+            return 0;
         }
 #if PROTOCOL_VERSION < 552
-		return cached->GetBiome((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH);
+        return chunk->GetBiome(pos.x & (CHUNK_WIDTH - 1), pos.z & (CHUNK_WIDTH - 1));
 #else
-        return cached->GetBiome((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH);
+        return chunk->GetBiome(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1));
 #endif
-	}
+    }
 
     const unsigned char World::GetSkyLight(const Position &pos)
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
-
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-            }
-            else
-            {
-                return 0;
-            }
+            return 0;
         }
 
-        return cached->GetSkyLight(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH));
+        return chunk->GetSkyLight(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
     }
 
     const unsigned char World::GetBlockLight(const Position &pos)
     {
-        int chunk_x = (int)floor(pos.x / (double)CHUNK_WIDTH);
-        int chunk_z = (int)floor(pos.z / (double)CHUNK_WIDTH);
+        const int chunk_x = pos.x >> CHUNK_WIDTH_BITS;
+        const int chunk_z = pos.z >> CHUNK_WIDTH_BITS;
 
-        if (!cached || cached_x != chunk_x || cached_z != chunk_z)
+        const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ chunk_x, chunk_z });
-
-            if (it != terrain.end())
-            {
-                cached_x = chunk_x;
-                cached_z = chunk_z;
-                cached = it->second;
-            }
-            else
-            {
-                return 0;
-            }
+            return 0;
         }
 
-        return cached->GetBlockLight(Position((pos.x % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH, pos.y, (pos.z % CHUNK_WIDTH + CHUNK_WIDTH) % CHUNK_WIDTH));
+        return chunk->GetBlockLight(Position(pos.x & (CHUNK_WIDTH - 1), pos.y, pos.z & (CHUNK_WIDTH - 1)));
     }
 
 #if PROTOCOL_VERSION < 719
@@ -730,75 +690,719 @@ namespace Botcraft
     const std::string World::GetDimension(const int x, const int z)
 #endif
     {
-        if (!cached || cached_x != x || cached_z != z)
+        const Chunk* chunk = GetChunkForReading(x, z);
+        if (chunk == nullptr)
         {
-            auto it = terrain.find({ x, z });
-
-            if (it != terrain.end())
-            {
-                cached_x = x;
-                cached_z = z;
-                cached = it->second;
-            }
-            else
-            {
 #if PROTOCOL_VERSION < 719
-                return Dimension::None;
+            return Dimension::None;
 #else
-                return "";
+            return "";
 #endif
-            }
         }
-        return cached->GetDimension();
+
+        return chunk->GetDimension();
     }
 
 
-    const std::map<std::pair<int, int>, std::shared_ptr<Chunk> >& World::GetAllChunks() const
+    const ChunkMap& World::GetAllChunks() const
     {
         return terrain;
     }
 
-    std::shared_ptr<Chunk> World::GetChunk(const int x, const int z)
+    void World::ForEachBlockInBox(const Position& min, const Position& max, const std::function<void(const Position&, const Block&)>& fn)
     {
-        if (!cached || cached_x != x || cached_z != z)
-        {
-            auto it = terrain.find({ x, z });
-
-            if (it != terrain.end())
+        ForEachSectionInBox(min, max, [&](const Position& origin, const Section& section, const Position& from, const Position& to)
             {
-                cached_x = x;
-                cached_z = z;
-                cached = it->second;
-            }
-            else
+                Position pos;
+                for (int y = from.y; y <= to.y; ++y)
+                {
+                    pos.y = origin.y + y;
+                    for (int z = from.z; z <= to.z; ++z)
+                    {
+                        pos.z = origin.z + z;
+                        const int index = y * CHUNK_WIDTH * CHUNK_WIDTH + z * CHUNK_WIDTH;
+                        for (int x = from.x; x <= to.x; ++x)
+                        {
+                            pos.x = origin.x + x;
+                            fn(pos, *section.GetBlock(index + x));
+                        }
+                    }
+                }
+            });
+    }
+
+    std::vector<Position> World::FindBlocks(const Position& min, const Position& max, const std::function<bool(const Blockstate&)>& predicate)
+    {
+        std::vector<Position> output;
+        std::vector<char> matching;
+
+        ForEachSectionInBox(min, max, [&](const Position& origin, const Section& section, const Position& from, const Position& to)
             {
-                return nullptr;
-            }
-        }
+                // Check the palette first, most of the time
+                // we can reject the whole section from there
+                const std::deque<Block>& palette = section.GetPalette();
+                matching.resize(palette.size());
+                bool any_match = false;
+                for (size_t i = 0; i < palette.size(); ++i)
+                {
+                    matching[i] = predicate(*palette[i].GetBlockstate());
+                    any_match = any_match || matching[i];
+                }
 
-        return cached;
+                if (!any_match)
+                {
+                    return;
+                }
+
+                Position pos;
+                for (int y = from.y; y <= to.y; ++y)
+                {
+                    pos.y = origin.y + y;
+                    for (int z = from.z; z <= to.z; ++z)
+                    {
+                        pos.z = origin.z + z;
+                        const int index = y * CHUNK_WIDTH * CHUNK_WIDTH + z * CHUNK_WIDTH;
+                        for (int x = from.x; x <= to.x; ++x)
+                        {
+                            if (matching[section.GetPaletteIndex(index + x)])
+                            {
+                                pos.x = origin.x + x;
+                                output.push_back(pos);
+                            }
+                        }
+                    }
+                }
+            });
+
+        return output;
     }
 
-    void World::Handle(ProtocolCraft::ClientboundLoginPacket& msg)
+    std::vector<Position> World::FindBlocks(const Position& min, const Position& max, const std::set<std::string>& names)
     {
-#if PROTOCOL_VERSION < 719
-        current_dimension = (Dimension)msg.GetDimension();
-#else
-        current_dimension = msg.GetDimension().GetName();
-#endif
-#if PROTOCOL_VERSION > 756
-        dimension_height[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("height"))->GetValue();
-        dimension_min_y[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("min_y"))->GetValue();
-#endif
+        return FindBlocks(min, max, [&names](const Blockstate& blockstate)
+            {
+                return names.find(blockstate.GetName()) != names.end();
+            });
     }
 
-    void World::Handle(ProtocolCraft::ClientboundRespawnPacket& msg)
+    void World::AddBlockIndex(const std::string& index_name, const std::set<std::string>& block_names)
     {
-        std::lock_guard<std::mutex> world_guard(world_mutex);
-        terrain = std::map<std::pair<int, int>, std::shared_ptr<Chunk> >();
+        BlockIndex& index = block_indices[index_name];
+        index.blockstates.clear();
+        index.positions.clear();
 
-#if PROTOCOL_VERSION < 719
-        current_dimension = (Dimension)msg.GetDimension();
+        const auto& blockstates = AssetsManager::getInstance().Blockstates();
+        for (auto it = blockstates.begin(); it != blockstates.end(); ++it)
+        {
+#if PROTOCOL_VERSION < 347
+            for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2)
+            {
+                if (block_names.find(it2->second->GetName()) != block_names.end())
+                {
+                    index.blockstates.insert(it2->second.get());
+                }
+            }
+#else
+            if (block_names.find(it->second->GetName()) != block_names.end())
+            {
+                index.blockstates.insert(it->second.get());
+            }
+#endif
+        }
+
+        for (auto it = terrain.begin(); it != terrain.end(); ++it)
+        {
+            const std::vector<Position> found = FindBlocks(
+                Position(it->first.first * CHUNK_WIDTH, it->second->GetMinY(), it->first.second * CHUNK_WIDTH),
+                Position(it->first.first * CHUNK_WIDTH + CHUNK_WIDTH - 1, it->second->GetMinY() + it->second->GetHeight() - 1, it->first.second * CHUNK_WIDTH + CHUNK_WIDTH - 1),
+                [&index](const Blockstate& blockstate)
+                {
+                    return index.blockstates.find(&blockstate) != index.blockstates.end();
+                });
+            if (!found.empty())
+            {
+                index.positions[it->first] = found;
+            }
+        }
+    }
+
+    void World::RemoveBlockIndex(const std::string& index_name)
+    {
+        block_indices.erase(index_name);
+    }
+
+    std::vector<Position> World::GetNearestIndexedBlocks(const std::string& index_name, const Position& pos, const size_t k)
+    {
+        return SearchBlockIndex(index_name, pos, k, std::numeric_limits<double>::max());
+    }
+
+    std::vector<Position> World::GetIndexedBlocksInRadius(const std::string& index_name, const Position& pos, const float radius)
+    {
+        return SearchBlockIndex(index_name, pos, std::numeric_limits<size_t>::max(), static_cast<double>(radius) * radius);
+    }
+
+    std::shared_ptr<Chunk> World::GetChunk(const int x, const int z)
+    {
+        auto it = terrain.find({ x, z });
+        if (it == terrain.end())
+        {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    const Chunk* World::GetChunkForReading(const int x, const int z) const
+    {
+        return terrain.Get(x, z);
+    }
+
+    void World::ForEachSectionInBox(const Position& min, const Position& max,
+        const std::function<void(const Position&, const Section&, const Position&, const Position&)>& fn) const
+    {
+        const Position box_min(std::min(min.x, max.x), std::min(min.y, max.y), std::min(min.z, max.z));
+        const Position box_max(std::max(min.x, max.x), std::max(min.y, max.y), std::max(min.z, max.z));
+
+        const int min_chunk_x = box_min.x >> CHUNK_WIDTH_BITS;
+        const int min_chunk_z = box_min.z >> CHUNK_WIDTH_BITS;
+        const int max_chunk_x = box_max.x >> CHUNK_WIDTH_BITS;
+        const int max_chunk_z = box_max.z >> CHUNK_WIDTH_BITS;
+
+        // If the box is larger than the loaded area, it's faster
+        // to go through the loaded chunks than through the box
+        std::vector<std::pair<std::pair<int, int>, const Chunk*> > chunks;
+        if ((max_chunk_x - min_chunk_x + 1.0) * (max_chunk_z - min_chunk_z + 1.0) > terrain.size())
+        {
+            for (auto it = terrain.begin(); it != terrain.end(); ++it)
+            {
+                if (it->first.first >= min_chunk_x && it->first.first <= max_chunk_x &&
+                    it->first.second >= min_chunk_z && it->first.second <= max_chunk_z)
+                {
+                    chunks.push_back({ it->first, it->second.get() });
+                }
+            }
+        }
+        else
+        {
+            for (int chunk_x = min_chunk_x; chunk_x <= max_chunk_x; ++chunk_x)
+            {
+                for (int chunk_z = min_chunk_z; chunk_z <= max_chunk_z; ++chunk_z)
+                {
+                    const Chunk* chunk = GetChunkForReading(chunk_x, chunk_z);
+                    if (chunk != nullptr)
+                    {
+                        chunks.push_back({ { chunk_x, chunk_z }, chunk });
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            const Chunk* chunk = chunks[i].second;
+            const int chunk_min_y = chunk->GetMinY();
+            const int from_y = std::max(box_min.y, chunk_min_y);
+            const int to_y = std::min(box_max.y, chunk_min_y + chunk->GetHeight() - 1);
+            if (from_y > to_y)
+            {
+                continue;
+            }
+
+            Position origin(chunks[i].first.first * CHUNK_WIDTH, 0, chunks[i].first.second * CHUNK_WIDTH);
+            Position from(std::max(box_min.x - origin.x, 0), 0, std::max(box_min.z - origin.z, 0));
+            Position to(std::min(box_max.x - origin.x, CHUNK_WIDTH - 1), 0, std::min(box_max.z - origin.z, CHUNK_WIDTH - 1));
+
+            for (int section_y = (from_y - chunk_min_y) / SECTION_HEIGHT; section_y <= (to_y - chunk_min_y) / SECTION_HEIGHT; ++section_y)
+            {
+                const std::shared_ptr<const Section> section = chunk->GetSection(section_y);
+                // Missing sections only contain air
+                if (section == nullptr)
+                {
+                    continue;
+                }
+
+                origin.y = chunk_min_y + section_y * SECTION_HEIGHT;
+                from.y = std::max(from_y - origin.y, 0);
+                to.y = std::min(to_y - origin.y, SECTION_HEIGHT - 1);
+
+                fn(origin, *section, from, to);
+            }
+        }
+    }
+
+    void World::IndexChunk(const int x, const int z)
+    {
+        if (block_indices.empty())
+        {
+            return;
+        }
+
+        std::shared_ptr<Chunk> chunk = GetChunk(x, z);
+        if (chunk == nullptr)
+        {
+            return;
+        }
+
+        const Position min_pos(x * CHUNK_WIDTH, chunk->GetMinY(), z * CHUNK_WIDTH);
+        const Position max_pos(x * CHUNK_WIDTH + CHUNK_WIDTH - 1, chunk->GetMinY() + chunk->GetHeight() - 1, z * CHUNK_WIDTH + CHUNK_WIDTH - 1);
+
+        for (auto it = block_indices.begin(); it != block_indices.end(); ++it)
+        {
+            BlockIndex& index = it->second;
+            std::vector<Position> found = FindBlocks(min_pos, max_pos, [&index](const Blockstate& blockstate)
+                {
+                    return index.blockstates.find(&blockstate) != index.blockstates.end();
+                });
+
+            if (found.empty())
+            {
+                index.positions.erase({ x, z });
+            }
+            else
+            {
+                index.positions[{ x, z }] = std::move(found);
+            }
+        }
+    }
+
+    void World::UpdateBlockIndices(const Position& pos, const Blockstate* old_blockstate, const Blockstate* new_blockstate)
+    {
+        if (old_blockstate == new_blockstate)
+        {
+            return;
+        }
+
+        const std::pair<int, int> chunk_coords(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS);
+
+        for (auto it = block_indices.begin(); it != block_indices.end(); ++it)
+        {
+            BlockIndex& index = it->second;
+            if (old_blockstate != nullptr && index.blockstates.find(old_blockstate) != index.blockstates.end())
+            {
+                auto chunk_it = index.positions.find(chunk_coords);
+                if (chunk_it != index.positions.end())
+                {
+                    std::vector<Position>& positions = chunk_it->second;
+                    positions.erase(std::remove(positions.begin(), positions.end(), pos), positions.end());
+                    if (positions.empty())
+                    {
+                        index.positions.erase(chunk_it);
+                    }
+                }
+            }
+            if (new_blockstate != nullptr && index.blockstates.find(new_blockstate) != index.blockstates.end())
+            {
+                index.positions[chunk_coords].push_back(pos);
+            }
+        }
+    }
+
+    std::vector<Position> World::SearchBlockIndex(const std::string& index_name, const Position& pos, const size_t k, const double max_sqr_distance) const
+    {
+        auto index_it = block_indices.find(index_name);
+        if (index_it == block_indices.end() || k == 0)
+        {
+            return std::vector<Position>();
+        }
+
+        // Sort the chunks by the distance between pos and their closest point
+        std::vector<std::pair<double, const std::vector<Position>*> > chunks;
+        for (auto it = index_it->second.positions.begin(); it != index_it->second.positions.end(); ++it)
+        {
+            const int min_x = it->first.first * CHUNK_WIDTH;
+            const int min_z = it->first.second * CHUNK_WIDTH;
+            const double dx = pos.x < min_x ? min_x - pos.x : std::max(pos.x - (min_x + CHUNK_WIDTH - 1), 0);
+            const double dz = pos.z < min_z ? min_z - pos.z : std::max(pos.z - (min_z + CHUNK_WIDTH - 1), 0);
+            const double sqr_distance = dx * dx + dz * dz;
+            if (sqr_distance <= max_sqr_distance)
+            {
+                chunks.push_back({ sqr_distance, &it->second });
+            }
+        }
+        std::sort(chunks.begin(), chunks.end(), [](const std::pair<double, const std::vector<Position>*>& a, const std::pair<double, const std::vector<Position>*>& b)
+            {
+                return a.first < b.first;
+            });
+
+        // Max heap with the k closest blocks found so far
+        auto compare = [](const std::pair<double, Position>& a, const std::pair<double, Position>& b)
+        {
+            return a.first < b.first;
+        };
+        std::vector<std::pair<double, Position> > closest;
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            // All the blocks in the next chunks are farther than the ones we have
+            if (closest.size() == k && chunks[i].first > closest.front().first)
+            {
+                break;
+            }
+
+            const std::vector<Position>& positions = *chunks[i].second;
+            for (size_t j = 0; j < positions.size(); ++j)
+            {
+                const Position diff = positions[j] - pos;
+                const double sqr_distance = static_cast<double>(diff.x) * diff.x + static_cast<double>(diff.y) * diff.y + static_cast<double>(diff.z) * diff.z;
+                if (sqr_distance > max_sqr_distance)
+                {
+                    continue;
+                }
+                if (closest.size() < k)
+                {
+                    closest.push_back({ sqr_distance, positions[j] });
+                    std::push_heap(closest.begin(), closest.end(), compare);
+                }
+                else if (sqr_distance < closest.front().first)
+                {
+                    std::pop_heap(closest.begin(), closest.end(), compare);
+                    closest.back() = { sqr_distance, positions[j] };
+                    std::push_heap(closest.begin(), closest.end(), compare);
+                }
+            }
+        }
+
+        std::sort_heap(closest.begin(), closest.end(), compare);
+        std::vector<Position> output(closest.size());
+        for (size_t i = 0; i < closest.size(); ++i)
+        {
+            output[i] = closest[i].second;
+        }
+
+        return output;
+    }
+
+    static const char SNAPSHOT_MAGIC[4] = { 'B', 'C', 'S', 'N' };
+    static const int SNAPSHOT_FORMAT_VERSION = 2;
+
+    bool World::SaveSnapshot(const std::string& path)
+    {
+        // Header: magic, format version, protocol version, size of the
+        // dimension data, dimension data (name, min y and height)
+        ProtocolCraft::WriteContainer dimension_data;
+        std::vector<std::pair<std::pair<int, int>, std::shared_ptr<const Chunk> > > chunks;
+        {
+            // Chunks are copied (cheap, as the sections are shared) and then
+            // written without keeping the world locked
+            std::shared_lock<std::shared_mutex> world_lock(world_mutex);
+#if PROTOCOL_VERSION < 719
+            ProtocolCraft::WriteData<int>(static_cast<int>(current_dimension), dimension_data);
+#else
+            ProtocolCraft::WriteData<std::string>(current_dimension, dimension_data);
+#endif
+#if PROTOCOL_VERSION < 757
+            ProtocolCraft::WriteData<int>(0, dimension_data);
+            ProtocolCraft::WriteData<int>(256, dimension_data);
+#else
+            auto min_y_it = dimension_min_y.find(current_dimension);
+            auto height_it = dimension_height.find(current_dimension);
+            if (min_y_it == dimension_min_y.end() || height_it == dimension_height.end())
+            {
+                std::cerr << "Error, can't save a snapshot without dimension" << std::endl;
+                return false;
+            }
+            ProtocolCraft::WriteData<int>(static_cast<int>(min_y_it->second), dimension_data);
+            ProtocolCraft::WriteData<int>(height_it->second, dimension_data);
+#endif
+
+            chunks.reserve(terrain.size());
+            for (auto it = terrain.begin(); it != terrain.end(); ++it)
+            {
+                chunks.push_back({ it->first, std::shared_ptr<const Chunk>(new Chunk(*it->second)) });
+            }
+        }
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Error, can't open snapshot file " << path << std::endl;
+            return false;
+        }
+
+        ProtocolCraft::WriteContainer header;
+        header.insert(header.end(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4);
+        ProtocolCraft::WriteData<int>(SNAPSHOT_FORMAT_VERSION, header);
+        ProtocolCraft::WriteData<int>(PROTOCOL_VERSION, header);
+        ProtocolCraft::WriteData<int>(static_cast<int>(dimension_data.size()), header);
+        header.insert(header.end(), dimension_data.begin(), dimension_data.end());
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+        // Then for each chunk: x, z, size of the data, data.
+        // The chunks are streamed one by one to the file
+        ProtocolCraft::WriteContainer chunk_data;
+        for (int i = 0; i < chunks.size(); ++i)
+        {
+            chunk_data.clear();
+            ProtocolCraft::WriteData<int>(chunks[i].first.first, chunk_data);
+            ProtocolCraft::WriteData<int>(chunks[i].first.second, chunk_data);
+            ProtocolCraft::WriteData<int>(0, chunk_data);
+            chunks[i].second->Serialize(chunk_data);
+
+            ProtocolCraft::WriteContainer chunk_size;
+            ProtocolCraft::WriteData<int>(static_cast<int>(chunk_data.size() - 12), chunk_size);
+            std::copy(chunk_size.begin(), chunk_size.end(), chunk_data.begin() + 8);
+
+            file.write(reinterpret_cast<const char*>(chunk_data.data()), chunk_data.size());
+        }
+
+        if (!file)
+        {
+            std::cerr << "Error writing snapshot file " << path << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool World::LoadSnapshot(const std::string& path)
+    {
+        MappedFile file;
+        if (!file.Open(path) || file.GetData() == nullptr)
+        {
+            std::cerr << "Error, can't open snapshot file " << path << std::endl;
+            return false;
+        }
+
+        const unsigned char* const data = file.GetData();
+        const size_t size = file.GetSize();
+
+        std::vector<std::pair<std::pair<int, int>, std::shared_ptr<Chunk> > > chunks;
+#if PROTOCOL_VERSION < 719
+        Dimension dimension;
+#else
+        std::string dimension;
+#endif
+        int min_y;
+        int height;
+        try
+        {
+            if (size < 16 || std::memcmp(data, SNAPSHOT_MAGIC, 4) != 0)
+            {
+                throw std::runtime_error("Not a snapshot file");
+            }
+
+            std::vector<unsigned char> header(data + 4, data + 16);
+            ProtocolCraft::ReadIterator iter = header.cbegin();
+            size_t length = header.size();
+            const int format_version = ProtocolCraft::ReadData<int>(iter, length);
+            const int protocol_version = ProtocolCraft::ReadData<int>(iter, length);
+            const int dimension_data_size = ProtocolCraft::ReadData<int>(iter, length);
+            if (format_version != SNAPSHOT_FORMAT_VERSION || protocol_version != PROTOCOL_VERSION)
+            {
+                throw std::runtime_error("Snapshot saved with another version");
+            }
+            if (dimension_data_size < 0 || 16 + static_cast<size_t>(dimension_data_size) > size)
+            {
+                throw std::runtime_error("Invalid dimension data");
+            }
+
+            header = std::vector<unsigned char>(data + 16, data + 16 + dimension_data_size);
+            iter = header.cbegin();
+            length = header.size();
+#if PROTOCOL_VERSION < 719
+            dimension = static_cast<Dimension>(ProtocolCraft::ReadData<int>(iter, length));
+#else
+            dimension = ProtocolCraft::ReadData<std::string>(iter, length);
+#endif
+            min_y = ProtocolCraft::ReadData<int>(iter, length);
+            height = ProtocolCraft::ReadData<int>(iter, length);
+
+            // Each chunk is only copied out of the mapping to be decoded
+            size_t offset = 16 + dimension_data_size;
+            std::vector<unsigned char> chunk_data;
+            while (offset < size)
+            {
+                if (offset + 12 > size)
+                {
+                    throw std::runtime_error("Truncated chunk header");
+                }
+                chunk_data.assign(data + offset, data + offset + 12);
+                iter = chunk_data.cbegin();
+                length = chunk_data.size();
+                const int x = ProtocolCraft::ReadData<int>(iter, length);
+                const int z = ProtocolCraft::ReadData<int>(iter, length);
+                const int chunk_size = ProtocolCraft::ReadData<int>(iter, length);
+                offset += 12;
+                if (chunk_size < 0 || offset + chunk_size > size)
+                {
+                    throw std::runtime_error("Truncated chunk data");
+                }
+
+                chunk_data.assign(data + offset, data + offset + chunk_size);
+                iter = chunk_data.cbegin();
+                length = chunk_data.size();
+                std::shared_ptr<Chunk> chunk = Chunk::Deserialize(iter, length, dimension, layers);
+                if (chunk->GetMinY() != min_y || chunk->GetHeight() != height)
+                {
+                    throw std::runtime_error("Chunk height doesn't match the dimension");
+                }
+                // Identical sections are shared with all the other chunks
+                chunk->InternSections();
+                chunks.push_back({ { x, z }, chunk });
+                offset += chunk_size;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error loading snapshot file " << path << ": " << e.what() << std::endl;
+            return false;
+        }
+
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            RecordAllChunksUnloaded();
+            terrain.clear();
+            pending_chunks.clear();
+            for (auto it = block_indices.begin(); it != block_indices.end(); ++it)
+            {
+                it->second.positions.clear();
+            }
+            current_dimension = dimension;
+#if PROTOCOL_VERSION > 756
+            dimension_min_y[current_dimension] = min_y;
+            dimension_height[current_dimension] = height;
+#endif
+            InsertChunks(chunks);
+            QueueChanges();
+        }
+        DeliverChanges();
+
+        return true;
+    }
+
+    void World::GenerateChunks(const int min_chunk_x, const int min_chunk_z, const int max_chunk_x, const int max_chunk_z,
+        const std::function<const Block*(const Position&)>& generator)
+    {
+        std::shared_ptr<Chunk> empty_chunk;
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+#if PROTOCOL_VERSION < 719
+            if (current_dimension == Dimension::None)
+            {
+                current_dimension = Dimension::Overworld;
+            }
+            empty_chunk = std::make_shared<Chunk>(current_dimension, layers);
+#else
+            if (current_dimension.empty())
+            {
+                current_dimension = "minecraft:overworld";
+            }
+#if PROTOCOL_VERSION < 757
+            empty_chunk = std::make_shared<Chunk>(current_dimension, layers);
+#else
+            // Same values as the vanilla overworld
+            if (dimension_height.find(current_dimension) == dimension_height.end())
+            {
+                dimension_min_y[current_dimension] = -64;
+                dimension_height[current_dimension] = 384;
+            }
+            empty_chunk = std::make_shared<Chunk>(dimension_min_y[current_dimension], dimension_height[current_dimension], current_dimension, layers);
+#endif
+#endif
+        }
+
+        // Chunks are generated without locking the world
+        std::vector<std::pair<std::pair<int, int>, std::shared_ptr<Chunk> > > chunks;
+        for (int chunk_x = std::min(min_chunk_x, max_chunk_x); chunk_x <= std::max(min_chunk_x, max_chunk_x); ++chunk_x)
+        {
+            for (int chunk_z = std::min(min_chunk_z, max_chunk_z); chunk_z <= std::max(min_chunk_z, max_chunk_z); ++chunk_z)
+            {
+                std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(*empty_chunk);
+                for (int y = chunk->GetMinY(); y < chunk->GetMinY() + chunk->GetHeight(); ++y)
+                {
+                    for (int z = 0; z < CHUNK_WIDTH; ++z)
+                    {
+                        for (int x = 0; x < CHUNK_WIDTH; ++x)
+                        {
+                            const Block* block = generator(Position(chunk_x * CHUNK_WIDTH + x, y, chunk_z * CHUNK_WIDTH + z));
+                            if (block != nullptr)
+                            {
+                                chunk->SetBlock(Position(x, y, z), block);
+                            }
+                        }
+                    }
+                }
+                // Identical sections are shared with all the other chunks
+                chunk->InternSections();
+                chunks.push_back({ { chunk_x, chunk_z }, chunk });
+            }
+        }
+
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            InsertChunks(chunks);
+            QueueChanges();
+        }
+        DeliverChanges();
+    }
+
+    const unsigned int World::SubscribeToChanges(const std::function<void(const std::vector<WorldChange>&)>& callback)
+    {
+        std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+        std::lock_guard<std::mutex> changes_guard(changes_mutex);
+        const unsigned int id = next_subscriber_id++;
+        change_subscribers[id] = callback;
+        recording_changes = true;
+        return id;
+    }
+
+    void World::UnsubscribeFromChanges(const unsigned int id)
+    {
+        std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+        std::lock_guard<std::mutex> changes_guard(changes_mutex);
+        change_subscribers.erase(id);
+        recording_changes = !change_subscribers.empty();
+        if (!recording_changes)
+        {
+            pending_changes.clear();
+            change_batches = std::queue<std::vector<WorldChange> >();
+        }
+    }
+
+    const unsigned long long int World::GetVersion() const
+    {
+        return version;
+    }
+
+    void World::Handle(ProtocolCraft::ClientboundLoginPacket& msg)
+    {
+#if PROTOCOL_VERSION < 719
+        current_dimension = (Dimension)msg.GetDimension();
+#else
+        current_dimension = msg.GetDimension().GetName();
+#endif
+#if PROTOCOL_VERSION > 756
+        dimension_height[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("height"))->GetValue();
+        dimension_min_y[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("min_y"))->GetValue();
+#endif
+    }
+
+    void World::Handle(ProtocolCraft::ClientboundRespawnPacket& msg)
+    {
+        std::unique_lock<std::shared_mutex> world_lock(world_mutex);
+        RecordAllChunksUnloaded();
+        // Chunks being decoded are from the previous dimension, forget
+        // them before the lock can be released so they are not published
+        pending_chunks.clear();
+        for (auto it = block_indices.begin(); it != block_indices.end(); ++it)
+        {
+            it->second.positions.clear();
+        }
+        if (region_cache != nullptr)
+        {
+            std::vector<std::pair<ChunkMap::key_type, std::shared_ptr<const Chunk> > > removed_chunks(terrain.begin(), terrain.end());
+            terrain.clear();
+            // Nothing else uses these chunks, they can be saved without the lock
+            world_lock.unlock();
+            for (int i = 0; i < removed_chunks.size(); ++i)
+            {
+                region_cache->Save(removed_chunks[i].first.first, removed_chunks[i].first.second, removed_chunks[i].second);
+            }
+            world_lock.lock();
+        }
+        terrain.clear();
+
+#if PROTOCOL_VERSION < 719
+        current_dimension = (Dimension)msg.GetDimension();
 #else
         current_dimension = msg.GetDimension().GetName();
 #endif
@@ -806,164 +1410,558 @@ namespace Botcraft
         dimension_height[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("height"))->GetValue();
         dimension_min_y[current_dimension] = std::dynamic_pointer_cast<ProtocolCraft::TagInt>(msg.GetDimensionType().GetTag("min_y"))->GetValue();
 #endif
+        QueueChanges();
+        world_lock.unlock();
+        DeliverChanges();
+    }
+
+    void World::Handle(ProtocolCraft::ClientboundBlockUpdatePacket& msg)
+    {
+        const Position pos = msg.GetPos();
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+#if PROTOCOL_VERSION < 347
+            unsigned int id;
+            unsigned char metadata;
+            Blockstate::IdToIdMetadata(msg.GetBlockstate(), id, metadata);
+            ApplyOrDefer(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS, [this, pos, id, metadata]() { SetBlock(pos, id, metadata); });
+#else
+            const unsigned int id = msg.GetBlockstate();
+            ApplyOrDefer(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS, [this, pos, id]() { SetBlock(pos, id); });
+#endif
+            QueueChanges();
+        }
+        DeliverChanges();
+    }
+
+    void World::Handle(ProtocolCraft::ClientboundSectionBlocksUpdatePacket& msg)
+    {
+        std::vector<std::pair<Position, unsigned int> > blocks;
+#if PROTOCOL_VERSION < 739
+        blocks.reserve(msg.GetRecordCount());
+        for (int i = 0; i < msg.GetRecordCount(); ++i)
+        {
+            unsigned char x = (msg.GetRecords()[i].GetHorizontalPosition() >> 4) & 0x0F;
+            unsigned char z = msg.GetRecords()[i].GetHorizontalPosition() & 0x0F;
+
+            const int x_pos = CHUNK_WIDTH * msg.GetChunkX() + x;
+            const int y_pos = msg.GetRecords()[i].GetYCoordinate();
+            const int z_pos = CHUNK_WIDTH * msg.GetChunkZ() + z;
+
+            blocks.push_back({ Position(x_pos, y_pos, z_pos), static_cast<unsigned int>(msg.GetRecords()[i].GetBlockId()) });
+        }
+#else
+        const int chunk_x = CHUNK_WIDTH * (msg.GetSectionPos() >> 42); // 22 bits
+        const int chunk_z = CHUNK_WIDTH * (msg.GetSectionPos() << 22 >> 42); // 22 bits
+        const int chunk_y = SECTION_HEIGHT * (msg.GetSectionPos() << 44 >> 44); // 20 bits
+
+        const size_t data_size = msg.GetPositions().size();
+        blocks.reserve(data_size);
+        for (int i = 0; i < data_size; ++i)
+        {
+            const int x_pos = chunk_x + ((msg.GetPositions()[i] >> 8) & 0xF);
+            const int z_pos = chunk_z + ((msg.GetPositions()[i] >> 4) & 0xF);
+            const int y_pos = chunk_y + ((msg.GetPositions()[i] >> 0) & 0xF);
+
+            blocks.push_back({ Position(x_pos, y_pos, z_pos), static_cast<unsigned int>(msg.GetStates()[i]) });
+        }
+#endif
+
+        // All the blocks of the packet are applied at once
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            ApplyBlockBatch(blocks);
+            QueueChanges();
+        }
+        DeliverChanges();
+    }
+
+    void World::Handle(ProtocolCraft::ClientboundForgetLevelChunkPacket& msg)
+    {
+        std::shared_ptr<const Chunk> removed_chunk;
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            // If the chunk is being decoded, it won't be swapped in
+            pending_chunks.erase({ msg.GetX(), msg.GetZ() });
+            if (region_cache != nullptr)
+            {
+                removed_chunk = GetChunk(msg.GetX(), msg.GetZ());
+            }
+            RemoveChunk(msg.GetX(), msg.GetZ());
+            QueueChanges();
+        }
+        DeliverChanges();
+
+        // The chunk is not in the world anymore, it can be saved without the lock
+        if (removed_chunk != nullptr)
+        {
+            region_cache->Save(msg.GetX(), msg.GetZ(), removed_chunk);
+        }
+    }
+
+#if PROTOCOL_VERSION < 757
+    void World::Handle(ProtocolCraft::ClientboundLevelChunkPacket& msg)
+    {
+        const int x = msg.GetX();
+        const int z = msg.GetZ();
+
+#if PROTOCOL_VERSION < 755
+        if (!msg.GetFullChunk())
+        {
+            // Partial chunks are applied in place, after the
+            // full chunk if it's still being decoded
+            std::unique_lock<std::shared_mutex> world_lock(world_mutex);
+            if (pending_chunks.find({ x, z }) == pending_chunks.end())
+            {
+#if PROTOCOL_VERSION < 552
+                LoadDataInChunk(x, z, msg.GetBuffer(), msg.GetAvailableSections(), false);
+#else
+                LoadDataInChunk(x, z, msg.GetBuffer(), msg.GetAvailableSections());
+#endif
+                LoadBlockEntityDataInChunk(x, z, msg.GetBlockEntitiesTags());
+            }
+            else
+            {
+                std::shared_ptr<ProtocolCraft::ClientboundLevelChunkPacket> packet = std::make_shared<ProtocolCraft::ClientboundLevelChunkPacket>(msg);
+                ApplyOrDefer(x, z, [this, packet]()
+                    {
+#if PROTOCOL_VERSION < 552
+                        LoadDataInChunk(packet->GetX(), packet->GetZ(), packet->GetBuffer(), packet->GetAvailableSections(), false);
+#else
+                        LoadDataInChunk(packet->GetX(), packet->GetZ(), packet->GetBuffer(), packet->GetAvailableSections());
+#endif
+                        LoadBlockEntityDataInChunk(packet->GetX(), packet->GetZ(), packet->GetBlockEntitiesTags());
+                    });
+            }
+            QueueChanges();
+            world_lock.unlock();
+            DeliverChanges();
+            return;
+        }
+#endif
+
+        // The chunk is decoded into a copy of the current one
+        // (if any, to keep the light already received), no lock
+        // is held during the decoding
+        std::shared_ptr<Chunk> chunk;
+        unsigned long long int sequence;
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            sequence = StartChunkDecoding(x, z);
+            const Chunk* current_chunk = GetChunkForReading(x, z);
+            if (current_chunk != nullptr && current_chunk->GetDimension() == current_dimension)
+            {
+                chunk = std::make_shared<Chunk>(*current_chunk);
+            }
+            else
+            {
+                chunk = std::make_shared<Chunk>(current_dimension, layers);
+            }
+        }
+
+        std::function<void(const ProtocolCraft::ClientboundLevelChunkPacket&)> decode = [this, chunk, sequence](const ProtocolCraft::ClientboundLevelChunkPacket& packet)
+        {
+#if PROTOCOL_VERSION < 552
+            chunk->LoadChunkData(packet.GetBuffer(), packet.GetAvailableSections(), packet.GetFullChunk());
+#else
+            chunk->LoadChunkData(packet.GetBuffer(), packet.GetAvailableSections());
+            chunk->SetBiomes(packet.GetBiomes());
+#endif
+#if PROTOCOL_VERSION > 442
+            chunk->LoadHeightmaps(packet.GetHeightmaps());
+#else
+            chunk->ComputeHeightmaps();
+#endif
+            chunk->LoadChunkBlockEntitiesData(packet.GetBlockEntitiesTags());
+            // Identical sections are shared with all the other chunks
+            chunk->InternSections();
+            PublishChunk(packet.GetX(), packet.GetZ(), sequence, chunk);
+        };
+
+        if (decoding_threads.empty())
+        {
+            decode(msg);
+        }
+        else
+        {
+            std::shared_ptr<ProtocolCraft::ClientboundLevelChunkPacket> packet = std::make_shared<ProtocolCraft::ClientboundLevelChunkPacket>(msg);
+            RunChunkDecoding([decode, packet]() { decode(*packet); });
+        }
+    }
+#else
+    void World::Handle(ProtocolCraft::ClientboundLevelChunkWithLightPacket& msg)
+    {
+        const int x = msg.GetX();
+        const int z = msg.GetZ();
+
+        // The chunk is decoded into a copy of the current one
+        // (if any), no lock is held during the decoding
+        std::shared_ptr<Chunk> chunk;
+        unsigned long long int sequence;
+        {
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            sequence = StartChunkDecoding(x, z);
+            const Chunk* current_chunk = GetChunkForReading(x, z);
+            if (current_chunk != nullptr && current_chunk->GetDimension() == current_dimension)
+            {
+                chunk = std::make_shared<Chunk>(*current_chunk);
+            }
+            else
+            {
+                chunk = std::make_shared<Chunk>(dimension_min_y[current_dimension], dimension_height[current_dimension], current_dimension, layers);
+            }
+        }
+
+        std::function<void(const ProtocolCraft::ClientboundLevelChunkWithLightPacket&)> decode = [this, chunk, sequence](const ProtocolCraft::ClientboundLevelChunkWithLightPacket& packet)
+        {
+            chunk->LoadChunkData(packet.GetChunkData().GetBuffer());
+            chunk->LoadHeightmaps(packet.GetChunkData().GetHeightmaps());
+            chunk->LoadChunkBlockEntitiesData(packet.GetChunkData().GetBlockEntitiesData());
+            chunk->LoadLightData(packet.GetLightData().GetSkyYMask(), packet.GetLightData().GetEmptySkyYMask(), packet.GetLightData().GetSkyUpdates(), true);
+            chunk->LoadLightData(packet.GetLightData().GetBlockYMask(), packet.GetLightData().GetEmptyBlockYMask(), packet.GetLightData().GetBlockUpdates(), false);
+            // Identical sections are shared with all the other chunks
+            chunk->InternSections();
+            PublishChunk(packet.GetX(), packet.GetZ(), sequence, chunk);
+        };
+
+        if (decoding_threads.empty())
+        {
+            decode(msg);
+        }
+        else
+        {
+            std::shared_ptr<ProtocolCraft::ClientboundLevelChunkWithLightPacket> packet = std::make_shared<ProtocolCraft::ClientboundLevelChunkWithLightPacket>(msg);
+            RunChunkDecoding([decode, packet]() { decode(*packet); });
+        }
     }
+#endif
 
-    void World::Handle(ProtocolCraft::ClientboundBlockUpdatePacket& msg)
+    const unsigned long long int World::StartChunkDecoding(const int x, const int z)
     {
-        std::lock_guard<std::mutex> world_guard(world_mutex);
-#if PROTOCOL_VERSION < 347
-        unsigned int id;
-        unsigned char metadata;
-        Blockstate::IdToIdMetadata(msg.GetBlockstate(), id, metadata);
-        SetBlock(msg.GetPos(), id, metadata);
-#else
-        SetBlock(msg.GetPos(), msg.GetBlockstate());
-#endif
+        PendingChunk& pending = pending_chunks[{ x, z }];
+        pending.sequence = ++chunk_sequence;
+        // Modifications received before this packet
+        // will be overwritten by its data
+        pending.deferred.clear();
+        return pending.sequence;
     }
 
-    void World::Handle(ProtocolCraft::ClientboundSectionBlocksUpdatePacket& msg)
+    void World::RunChunkDecoding(std::function<void()>&& fn)
     {
-#if PROTOCOL_VERSION < 739
-        for (int i = 0; i < msg.GetRecordCount(); ++i)
+        if (decoding_threads.empty())
         {
-            unsigned char x = (msg.GetRecords()[i].GetHorizontalPosition() >> 4) & 0x0F;
-            unsigned char z = msg.GetRecords()[i].GetHorizontalPosition() & 0x0F;
+            fn();
+            return;
+        }
 
-            const int x_pos = CHUNK_WIDTH * msg.GetChunkX() + x;
-            const int y_pos = msg.GetRecords()[i].GetYCoordinate();
-            const int z_pos = CHUNK_WIDTH * msg.GetChunkZ() + z;
-#else
-        const int chunk_x = CHUNK_WIDTH * (msg.GetSectionPos() >> 42); // 22 bits
-        const int chunk_z = CHUNK_WIDTH * (msg.GetSectionPos() << 22 >> 42); // 22 bits
-        const int chunk_y = SECTION_HEIGHT * (msg.GetSectionPos() << 44 >> 44); // 20 bits
+        std::lock_guard<std::mutex> decoding_guard(decoding_mutex);
+        decoding_queue.push(std::move(fn));
+        decoding_condition_variable.notify_one();
+    }
 
-        const size_t data_size = msg.GetPositions().size();
-        for (int i = 0; i < data_size; ++i)
+    void World::PublishChunk(const int x, const int z, const unsigned long long int sequence, const std::shared_ptr<Chunk>& chunk)
+    {
         {
-            const unsigned int block_id = msg.GetStates()[i];
+            std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+            auto it = pending_chunks.find({ x, z });
+            // Chunk unloaded, dimension changed or a newer
+            // packet received for this chunk in the meantime
+            if (it == pending_chunks.end() || it->second.sequence != sequence)
+            {
+                return;
+            }
 
-            const int x_pos = chunk_x + ((msg.GetPositions()[i] >> 8) & 0xF);
-            const int z_pos = chunk_z + ((msg.GetPositions()[i] >> 4) & 0xF);
-            const int y_pos = chunk_y + ((msg.GetPositions()[i] >> 0) & 0xF);
+            terrain.insert_or_assign({ x, z }, chunk);
+#if USE_GUI
+            chunk->SetModifiedSinceLastRender(true);
+#endif
+            RecordChange(WorldChange::Type::ChunkLoaded, x, z);
+
+            std::vector<std::function<void()> > deferred = std::move(it->second.deferred);
+            pending_chunks.erase(it);
+            for (int i = 0; i < deferred.size(); ++i)
+            {
+                deferred[i]();
+            }
+
+            IndexChunk(x, z);
+            UpdateChunk(x, z);
+            QueueChanges();
+        }
+        DeliverChanges();
+    }
+
+    void World::InsertChunks(const std::vector<std::pair<std::pair<int, int>, std::shared_ptr<Chunk> > >& chunks)
+    {
+        for (int i = 0; i < chunks.size(); ++i)
+        {
+            const int x = chunks[i].first.first;
+            const int z = chunks[i].first.second;
+            // Packets being decoded are older than these chunks
+            pending_chunks.erase({ x, z });
+            terrain.insert_or_assign({ x, z }, chunks[i].second);
+#if USE_GUI
+            chunks[i].second->SetModifiedSinceLastRender(true);
 #endif
-            Position cube_pos(x_pos, y_pos, z_pos);
+            RecordChange(WorldChange::Type::ChunkLoaded, x, z);
+            IndexChunk(x, z);
+            UpdateChunk(x, z);
+        }
+    }
+
+    void World::ApplyChunkBlockBatch(const int x, const int z, const std::vector<std::pair<Position, unsigned int> >& blocks)
+    {
+        Chunk* chunk = terrain.Get(x, z);
+        if (chunk == nullptr)
+        {
+            return;
+        }
+
+        const int min_y = chunk->GetMinY();
+        const int num_sections = chunk->GetHeight() / SECTION_HEIGHT;
+        // Sort the blocks by section, keeping their order in a section
+        std::vector<int> order;
+        order.reserve(blocks.size());
+        for (int i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i].first.y >= min_y && blocks[i].first.y < min_y + num_sections * SECTION_HEIGHT)
+            {
+                order.push_back(i);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&blocks, min_y](const int a, const int b)
+            {
+                return (blocks[a].first.y - min_y) / SECTION_HEIGHT < (blocks[b].first.y - min_y) / SECTION_HEIGHT;
+            });
 
+        const bool track_blockstates = !block_indices.empty() || recording_changes;
+        std::vector<std::pair<int, Block> > section_blocks;
+        std::vector<std::pair<const Blockstate*, const Blockstate*> > blockstates;
+        Position update_neg;
+        Position update_pos;
+        size_t start = 0;
+        while (start < order.size())
+        {
+            const int section_y = (blocks[order[start]].first.y - min_y) / SECTION_HEIGHT;
+            section_blocks.clear();
+            size_t end = start;
+            for (; end < order.size() && (blocks[order[end]].first.y - min_y) / SECTION_HEIGHT == section_y; ++end)
             {
-                std::lock_guard<std::mutex> world_guard(world_mutex);
+                const Position& pos = blocks[order[end]].first;
+                const int in_chunk_x = pos.x & (CHUNK_WIDTH - 1);
+                const int in_chunk_z = pos.z & (CHUNK_WIDTH - 1);
 #if PROTOCOL_VERSION < 347
                 unsigned int id;
                 unsigned char metadata;
-                Blockstate::IdToIdMetadata(msg.GetRecords()[i].GetBlockId(), id, metadata);
-
-                SetBlock(cube_pos, id, metadata);
-#elif PROTOCOL_VERSION < 739
-                SetBlock(cube_pos, msg.GetRecords()[i].GetBlockId());
+                Blockstate::IdToIdMetadata(blocks[order[end]].second, id, metadata);
+                const Block block(id, metadata);
 #else
-                SetBlock(cube_pos, block_id);
+                const Block block(blocks[order[end]].second);
 #endif
+                section_blocks.push_back({ ((pos.y - min_y) % SECTION_HEIGHT) * CHUNK_WIDTH * CHUNK_WIDTH + in_chunk_z * CHUNK_WIDTH + in_chunk_x, block });
+
+                // Neighbours to update once all the blocks are set
+                update_neg.x = in_chunk_x == 0 ? -1 : update_neg.x;
+                update_pos.x = in_chunk_x == CHUNK_WIDTH - 1 ? 1 : update_pos.x;
+                update_neg.z = in_chunk_z == 0 ? -1 : update_neg.z;
+                update_pos.z = in_chunk_z == CHUNK_WIDTH - 1 ? 1 : update_pos.z;
+            }
+
+            chunk->SetSectionBlocks(section_y, section_blocks, track_blockstates ? &blockstates : nullptr);
+
+            if (track_blockstates)
+            {
+                for (int i = 0; i < blockstates.size(); ++i)
+                {
+                    const Position& pos = blocks[order[start + i]].first;
+                    if (!block_indices.empty())
+                    {
+                        UpdateBlockIndices(pos, blockstates[i].first, blockstates[i].second);
+                    }
+                    // The server often sends blocks that didn't change
+                    if (blockstates[i].first != blockstates[i].second)
+                    {
+                        RecordChange(WorldChange::Type::BlockChanged, x, z, pos, blockstates[i].first, blockstates[i].second);
+                    }
+                }
             }
+
+            start = end;
+        }
+
+        if (update_neg.x != 0 || update_neg.z != 0)
+        {
+            UpdateChunk(x, z, update_neg);
+        }
+        if (update_pos.x != 0 || update_pos.z != 0)
+        {
+            UpdateChunk(x, z, update_pos);
         }
     }
 
-    void World::Handle(ProtocolCraft::ClientboundForgetLevelChunkPacket& msg)
+    void World::RecordChange(const WorldChange::Type type, const int chunk_x, const int chunk_z, const Position& pos,
+        const Blockstate* old_blockstate, const Blockstate* new_blockstate)
     {
-        std::lock_guard<std::mutex> world_guard(world_mutex);
-        RemoveChunk(msg.GetX(), msg.GetZ());
+        ++version;
+        if (!recording_changes)
+        {
+            return;
+        }
+
+        WorldChange change;
+        change.type = type;
+        change.version = version;
+        change.chunk_x = chunk_x;
+        change.chunk_z = chunk_z;
+        change.pos = pos;
+        change.old_blockstate = old_blockstate;
+        change.new_blockstate = new_blockstate;
+        pending_changes.push_back(change);
     }
 
-#if PROTOCOL_VERSION < 757
-    void World::Handle(ProtocolCraft::ClientboundLevelChunkPacket& msg)
+    void World::RecordAllChunksUnloaded()
     {
-#if PROTOCOL_VERSION < 719
-        Dimension chunk_dim;
-#else
-        std::string chunk_dim;
-#endif
+        for (auto it = terrain.begin(); it != terrain.end(); ++it)
+        {
+            RecordChange(WorldChange::Type::ChunkUnloaded, it->first.first, it->first.second);
+        }
+    }
+
+    void World::QueueChanges()
+    {
+        if (pending_changes.empty())
         {
-            std::lock_guard<std::mutex> world_guard(world_mutex);
-            chunk_dim = GetDimension(msg.GetX(), msg.GetZ());
+            return;
         }
 
-#if PROTOCOL_VERSION < 755
-        if (msg.GetFullChunk())
+        // Batches are queued with the world locked, so they are in the changes order
+        std::lock_guard<std::mutex> changes_guard(changes_mutex);
+        change_batches.push(std::move(pending_changes));
+        pending_changes.clear();
+    }
+
+    void World::DeliverChanges()
+    {
+        std::unique_lock<std::mutex> changes_lock(changes_mutex);
+        // Another thread is already calling the subscribers, it
+        // will deliver the batches queued by this one after its own
+        if (delivering_changes)
         {
-#endif
-            bool success = true;
+            return;
+        }
 
-            if (chunk_dim != current_dimension)
-            {
-                std::lock_guard<std::mutex> world_guard(world_mutex);
-                success = AddChunk(msg.GetX(), msg.GetZ(), current_dimension);
-            }
+        delivering_changes = true;
+        while (!change_batches.empty())
+        {
+            const std::vector<WorldChange> batch = std::move(change_batches.front());
+            change_batches.pop();
+            const std::map<unsigned int, std::function<void(const std::vector<WorldChange>&)> > subscribers = change_subscribers;
 
-            if (!success)
+            // Subscribers are called without any lock, so they can read the world
+            changes_lock.unlock();
+            for (auto it = subscribers.begin(); it != subscribers.end(); ++it)
             {
-                std::cerr << "Error adding chunk in pos : " << msg.GetX() << ", " << msg.GetZ() << " in dimension " <<
-#if PROTOCOL_VERSION < 719
-                    (int)current_dimension
-#else
-                    current_dimension
-#endif
-                    << std::endl;
-                return;
+                try
+                {
+                    it->second(batch);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Error in world changes subscriber " << it->first << ": " << e.what() << std::endl;
+                }
+                catch (...)
+                {
+                    std::cerr << "Unknown error in world changes subscriber " << it->first << std::endl;
+                }
             }
-#if PROTOCOL_VERSION < 755
+            changes_lock.lock();
         }
-#endif
+        delivering_changes = false;
+    }
 
-        { // lock guard scope
-            std::lock_guard<std::mutex> world_guard(world_mutex);
-#if PROTOCOL_VERSION < 552
-            LoadDataInChunk(msg.GetX(), msg.GetZ(), msg.GetBuffer(), msg.GetAvailableSections(), msg.GetFullChunk());
-#else
-            LoadDataInChunk(msg.GetX(), msg.GetZ(), msg.GetBuffer(), msg.GetAvailableSections());
-#if PROTOCOL_VERSION < 755
-            if (msg.GetFullChunk())
+    void World::ProcessChunkDecoding()
+    {
+        while (true)
+        {
+            std::function<void()> fn;
             {
-                LoadBiomesInChunk(msg.GetX(), msg.GetZ(), msg.GetBiomes());
+                std::unique_lock<std::mutex> lck(decoding_mutex);
+                decoding_condition_variable.wait(lck, [this]() { return !decoding || !decoding_queue.empty(); });
+                if (!decoding)
+                {
+                    return;
+                }
+                fn = std::move(decoding_queue.front());
+                decoding_queue.pop();
             }
-#else
-            LoadBiomesInChunk(msg.GetX(), msg.GetZ(), msg.GetBiomes());
-#endif
-#endif
-            LoadBlockEntityDataInChunk(msg.GetX(), msg.GetZ(), msg.GetBlockEntitiesTags());
+            fn();
         }
     }
-#else
-    void World::Handle(ProtocolCraft::ClientboundLevelChunkWithLightPacket& msg)
+
+    const unsigned int World::RegisterClient()
+    {
+        std::lock_guard<std::mutex> clients_guard(clients_mutex);
+        return next_client_id++;
+    }
+
+    const bool World::AcquireChunk(const unsigned int client, const int x, const int z)
     {
-        std::string chunk_dim;
+        std::lock_guard<std::mutex> clients_guard(clients_mutex);
+        std::vector<unsigned int>& clients = chunk_clients[{ x, z }];
+        if (std::find(clients.begin(), clients.end(), client) == clients.end())
         {
-            std::lock_guard<std::mutex> world_guard(world_mutex);
-            chunk_dim = GetDimension(msg.GetX(), msg.GetZ());
+            clients.push_back(client);
         }
+        return clients.front() == client;
+    }
 
-        bool success = true;
-
-        if (chunk_dim != current_dimension)
+    const bool World::ReleaseChunk(const unsigned int client, const int x, const int z)
+    {
+        std::lock_guard<std::mutex> clients_guard(clients_mutex);
+        auto it = chunk_clients.find({ x, z });
+        if (it == chunk_clients.end())
         {
-            std::lock_guard<std::mutex> world_guard(world_mutex);
-            success = AddChunk(msg.GetX(), msg.GetZ(), current_dimension);
+            return true;
         }
 
-        if (!success)
+        // If client was the first one, the next
+        // one will now have its packets applied
+        it->second.erase(std::remove(it->second.begin(), it->second.end(), client), it->second.end());
+        if (it->second.empty())
         {
-            std::cerr << "Error adding chunk in pos : " << msg.GetX() << ", " << msg.GetZ() << " in dimension " << current_dimension << std::endl;
-            return;
+            chunk_clients.erase(it);
+            return true;
         }
+        return false;
+    }
+
+    const bool World::IsChunkOwner(const unsigned int client, const int x, const int z)
+    {
+        std::lock_guard<std::mutex> clients_guard(clients_mutex);
+        auto it = chunk_clients.find({ x, z });
+        return it == chunk_clients.end() || it->second.front() == client;
+    }
 
+    std::vector<std::pair<int, int> > World::ReleaseClient(const unsigned int client, bool& other_clients)
+    {
+        std::lock_guard<std::mutex> clients_guard(clients_mutex);
+        std::vector<std::pair<int, int> > output;
+        for (auto it = chunk_clients.begin(); it != chunk_clients.end();)
         {
-            // lock guard scope
-            std::lock_guard<std::mutex> world_guard(world_mutex);
-            LoadDataInChunk(msg.GetX(), msg.GetZ(), msg.GetChunkData().GetBuffer());
-            LoadBlockEntityDataInChunk(msg.GetX(), msg.GetZ(), msg.GetChunkData().GetBlockEntitiesData());
-            UpdateChunkLight(msg.GetX(), msg.GetZ(), current_dimension,
-                msg.GetLightData().GetSkyYMask(), msg.GetLightData().GetEmptySkyYMask(), msg.GetLightData().GetSkyUpdates(), true);
-            UpdateChunkLight(msg.GetX(), msg.GetZ(), current_dimension,
-                msg.GetLightData().GetBlockYMask(), msg.GetLightData().GetEmptyBlockYMask(), msg.GetLightData().GetBlockUpdates(), false);
+            it->second.erase(std::remove(it->second.begin(), it->second.end(), client), it->second.end());
+            if (it->second.empty())
+            {
+                output.push_back(it->first);
+                it = chunk_clients.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
         }
+        other_clients = !chunk_clients.empty();
+        return output;
     }
-#endif
 
     std::shared_ptr<Blockstate> World::Raycast(const Vector3<double> &origin, const Vector3<double> &direction,
         const float max_radius, Position & out_pos, Position & out_normal)
@@ -1023,34 +2021,17 @@ namespace Botcraft
 
         const float radius = max_radius / std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
 
-        while (true)
+        // Move out_pos to the next cube along the ray,
+        // return false if it's farther than radius
+        auto step_to_next_cube = [&]()
         {
-            const Block* block = GetBlock(out_pos);
-
-            if (block)
-            {
-                std::shared_ptr<Blockstate> blockstate = block->GetBlockstate();
-                if (!block->GetBlockstate()->IsAir())
-                {
-                    const auto& cubes = blockstate->GetModel(block->GetModelId()).GetColliders();
-                    for (int i = 0; i < cubes.size(); ++i)
-                    {
-                        const AABB current_cube = cubes[i] + out_pos;
-                        if (current_cube.Intersect(origin, direction))
-                        {
-                            return blockstate;
-                        }
-                    }
-                }
-            }
-
             // select the direction in which the next face is
             // the closest
             if (tMax.x < tMax.y && tMax.x < tMax.z)
             {
                 if (tMax.x > radius)
                 {
-                    return nullptr;
+                    return false;
                 }
 
                 out_pos.x += step.x;
@@ -1063,34 +2044,146 @@ namespace Botcraft
             {
                 if (tMax.y > radius)
                 {
-                    return nullptr;
+                    return false;
                 }
                 out_pos.y += step.y;
                 tMax.y += tDelta.y;
-                out_normal[0] = 0;
-                out_normal[1] = -step.y;
-                out_normal[2] = 0;
+                out_normal.x = 0;
+                out_normal.y = -step.y;
+                out_normal.z = 0;
             }
             else // tMax.z < tMax.x && tMax.z < tMax.y
             {
                 if (tMax.z > radius)
                 {
-                    return nullptr;
+                    return false;
                 }
 
                 out_pos.z += step.z;
                 tMax.z += tDelta.z;
                 out_normal.x = 0;
-                out_normal.x = 0;
-                out_normal.x = -step.z;
+                out_normal.y = 0;
+                out_normal.z = -step.z;
+            }
+            return true;
+        };
+
+        // Sections are 16 blocks wide in all dimensions and aligned on 16
+        auto get_section_coords = [](const Position& pos)
+        {
+            return Position(pos.x >> CHUNK_WIDTH_BITS, pos.y >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS);
+        };
+
+        // The section containing out_pos is only looked for
+        // when the ray enters it, not for every cube
+        Position section_coords = get_section_coords(out_pos);
+        const Section* section = GetSectionForRaycast(out_pos);
+
+        while (true)
+        {
+            if (section == nullptr)
+            {
+                // Nothing to hit in this section, go through
+                // it without looking at the blocks
+                do
+                {
+                    if (!step_to_next_cube())
+                    {
+                        return nullptr;
+                    }
+                } while (get_section_coords(out_pos) == section_coords);
+            }
+            else
+            {
+                const Block* block = section->GetBlock(((out_pos.y & (SECTION_HEIGHT - 1)) * CHUNK_WIDTH + (out_pos.z & (CHUNK_WIDTH - 1))) * CHUNK_WIDTH + (out_pos.x & (CHUNK_WIDTH - 1)));
+                const std::shared_ptr<Blockstate>& blockstate = block->GetBlockstate();
+                if (!blockstate->IsAir())
+                {
+                    const auto& cubes = blockstate->GetModel(layers.model_variants ? blockstate->GetModelId(out_pos) : 0).GetColliders();
+                    for (int i = 0; i < cubes.size(); ++i)
+                    {
+                        const AABB current_cube = cubes[i] + out_pos;
+                        if (current_cube.Intersect(origin, direction))
+                        {
+                            return blockstate;
+                        }
+                    }
+                }
+
+                if (!step_to_next_cube())
+                {
+                    return nullptr;
+                }
+            }
+
+            const Position new_section_coords = get_section_coords(out_pos);
+            if (new_section_coords != section_coords)
+            {
+                section_coords = new_section_coords;
+                section = GetSectionForRaycast(out_pos);
             }
         }
     }
 
+    std::vector<std::shared_ptr<Blockstate> > World::Raycast(const std::vector<Vector3<double> >& origins, const std::vector<Vector3<double> >& directions,
+        const float max_radius, std::vector<Position>& out_pos, std::vector<Position>& out_normal)
+    {
+        if (origins.size() != directions.size())
+        {
+            throw(std::runtime_error("Raycasting with different numbers of origins and directions"));
+        }
+
+        std::vector<std::shared_ptr<Blockstate> > output(origins.size());
+        out_pos = std::vector<Position>(origins.size());
+        out_normal = std::vector<Position>(origins.size());
+        for (int i = 0; i < origins.size(); ++i)
+        {
+            output[i] = Raycast(origins[i], directions[i], max_radius, out_pos[i], out_normal[i]);
+        }
+
+        return output;
+    }
+
+    const Section* World::GetSectionForRaycast(const Position& pos) const
+    {
+        const Chunk* chunk = GetChunkForReading(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS);
+        if (chunk == nullptr || pos.y < chunk->GetMinY() || pos.y >= chunk->GetMinY() + chunk->GetHeight())
+        {
+            return nullptr;
+        }
+
+        const Section* section = chunk->GetSection((pos.y - chunk->GetMinY()) / SECTION_HEIGHT).get();
+        if (section == nullptr)
+        {
+            return nullptr;
+        }
+
+        // Only air in this section
+        if (section->GetNonAirCount() == 0)
+        {
+            return nullptr;
+        }
+
+        return section;
+    }
+
 #if PROTOCOL_VERSION > 404
     void World::Handle(ProtocolCraft::ClientboundLightUpdatePacket& msg)
     {
-        std::lock_guard<std::mutex> world_guard(world_mutex);
+        std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+        if (pending_chunks.find({ msg.GetX(), msg.GetZ() }) != pending_chunks.end())
+        {
+            std::shared_ptr<ProtocolCraft::ClientboundLightUpdatePacket> packet = std::make_shared<ProtocolCraft::ClientboundLightUpdatePacket>(msg);
+            ApplyOrDefer(msg.GetX(), msg.GetZ(), [this, packet]() { LoadLightUpdate(*packet); });
+        }
+        else
+        {
+            LoadLightUpdate(msg);
+        }
+    }
+
+    void World::LoadLightUpdate(const ProtocolCraft::ClientboundLightUpdatePacket& msg)
+    {
 #if PROTOCOL_VERSION < 757
         UpdateChunkLight(msg.GetX(), msg.GetZ(), current_dimension,
             msg.GetSkyYMask(), msg.GetEmptySkyYMask(), msg.GetSkyUpdates(), true);
@@ -1107,8 +2200,26 @@ namespace Botcraft
 
     void World::Handle(ProtocolCraft::ClientboundBlockEntityDataPacket& msg)
     {
-        std::lock_guard<std::mutex> world_guard(world_mutex);
-        SetBlockEntityData(msg.GetPos(), msg.GetTag());
+        const Position pos = msg.GetPos();
+        std::lock_guard<std::shared_mutex> world_guard(world_mutex);
+        if (pending_chunks.find({ pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS }) != pending_chunks.end())
+        {
+            const ProtocolCraft::NBT tag = msg.GetTag();
+#if PROTOCOL_VERSION < 757
+            ApplyOrDefer(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS, [this, pos, tag]() { SetBlockEntityData(pos, tag); });
+#else
+            const int type = msg.GetType();
+            ApplyOrDefer(pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS, [this, pos, tag, type]() { SetBlockEntityData(pos, tag, type); });
+#endif
+        }
+        else
+        {
+#if PROTOCOL_VERSION < 757
+            SetBlockEntityData(pos, msg.GetTag());
+#else
+            SetBlockEntityData(pos, msg.GetTag(), msg.GetType());
+#endif
+        }
     }
 
 } // Botcraft
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "botcraft/Game/World/WorldClientHandler.hpp"
+#include "botcraft/Game/World/World.hpp"
+
+using namespace ProtocolCraft;
+
+namespace Botcraft
+{
+    WorldClientHandler::WorldClientHandler(const std::shared_ptr<World>& world_)
+    {
+        world = world_;
+        world_handler = world->GetAsyncHandler();
+        client_id = world->RegisterClient();
+    }
+
+    WorldClientHandler::~WorldClientHandler()
+    {
+        ReleaseAllChunks();
+    }
+
+    void WorldClientHandler::Handle(Message& msg)
+    {
+        msg.Dispatch(world_handler);
+    }
+
+    void WorldClientHandler::Handle(ClientboundRespawnPacket& msg)
+    {
+        // Respawning clears the whole world, only
+        // do it if no other client is using it
+        if (!ReleaseAllChunks())
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+
+    void WorldClientHandler::Handle(ClientboundBlockUpdatePacket& msg)
+    {
+        const Position pos = msg.GetPos();
+        if (world->IsChunkOwner(client_id, pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+
+    void WorldClientHandler::Handle(ClientboundSectionBlocksUpdatePacket& msg)
+    {
+#if PROTOCOL_VERSION < 739
+        const int chunk_x = msg.GetChunkX();
+        const int chunk_z = msg.GetChunkZ();
+#else
+        const int chunk_x = static_cast<int>(msg.GetSectionPos() >> 42); // 22 bits
+        const int chunk_z = static_cast<int>(msg.GetSectionPos() << 22 >> 42); // 22 bits
+#endif
+        if (world->IsChunkOwner(client_id, chunk_x, chunk_z))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+
+    void WorldClientHandler::Handle(ClientboundForgetLevelChunkPacket& msg)
+    {
+        if (world->ReleaseChunk(client_id, msg.GetX(), msg.GetZ()))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+
+#if PROTOCOL_VERSION < 757
+    void WorldClientHandler::Handle(ClientboundLevelChunkPacket& msg)
+    {
+#if PROTOCOL_VERSION < 755
+        // Partial chunks are updates of an already loaded chunk
+        if (!msg.GetFullChunk())
+        {
+            if (world->IsChunkOwner(client_id, msg.GetX(), msg.GetZ()))
+            {
+                msg.Dispatch(world_handler);
+            }
+            return;
+        }
+#endif
+        if (world->AcquireChunk(client_id, msg.GetX(), msg.GetZ()))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+#else
+    void WorldClientHandler::Handle(ClientboundLevelChunkWithLightPacket& msg)
+    {
+        if (world->AcquireChunk(client_id, msg.GetX(), msg.GetZ()))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+#endif
+
+#if PROTOCOL_VERSION > 404
+    void WorldClientHandler::Handle(ClientboundLightUpdatePacket& msg)
+    {
+        // Light can be sent before the chunk data
+        if (world->AcquireChunk(client_id, msg.GetX(), msg.GetZ()))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+#endif
+
+    void WorldClientHandler::Handle(ClientboundBlockEntityDataPacket& msg)
+    {
+        const Position pos = msg.GetPos();
+        if (world->IsChunkOwner(client_id, pos.x >> CHUNK_WIDTH_BITS, pos.z >> CHUNK_WIDTH_BITS))
+        {
+            msg.Dispatch(world_handler);
+        }
+    }
+
+    const bool WorldClientHandler::ReleaseAllChunks()
+    {
+        bool other_clients = false;
+        const std::vector<std::pair<int, int> > unused_chunks = world->ReleaseClient(client_id, other_clients);
+
+        ClientboundForgetLevelChunkPacket forget_msg;
+        for (int i = 0; i < unused_chunks.size(); ++i)
+        {
+            forget_msg.SetX(unused_chunks[i].first);
+            forget_msg.SetZ(unused_chunks[i].second);
+            forget_msg.Dispatch(world_handler);
+        }
+
+        return other_clients;
+    }
+} // Botcraft
@@ -4,6 +4,7 @@
 #include "botcraft/Network/TCP_Com.hpp"
 #include "botcraft/Network/Authentifier.hpp"
 #include "botcraft/Network/AESEncrypter.hpp"
+#include "botcraft/Network/PacketLogger.hpp"
 
 #if USE_COMPRESSION
 #include "botcraft/Network/Compression.hpp"
@@ -110,6 +111,13 @@ namespace Botcraft
             std::lock_guard<std::mutex> lock(mutex_send);
             std::vector<unsigned char> msg_data;
             msg->Write(msg_data);
+
+            std::shared_ptr<PacketLogger> logger = std::atomic_load(&packet_logger);
+            if (logger)
+            {
+                logger->Log(*msg, msg_data, true, state);
+            }
+
             if (compression == -1)
             {
                 com->SendPacket(msg_data);
@@ -147,6 +155,11 @@ namespace Botcraft
         return name;
     }
 
+    void NetworkManager::SetPacketLogger(const std::shared_ptr<PacketLogger> logger)
+    {
+        std::atomic_store(&packet_logger, logger);
+    }
+
     void NetworkManager::WaitForNewPackets()
     {
         while (state != ProtocolCraft::ConnectionState::None)
@@ -220,6 +233,13 @@ namespace Botcraft
         if (msg)
         {
             msg->Read(packet_iterator, length);
+
+            std::shared_ptr<PacketLogger> logger = std::atomic_load(&packet_logger);
+            if (logger)
+            {
+                logger->Log(*msg, packet, false, state);
+            }
+
             for (int i = 0; i < subscribed.size(); i++)
             {
                 msg->Dispatch(subscribed[i]);
@@ -0,0 +1,273 @@
+#include <iostream>
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+#include <type_traits>
+
+#include "protocolCraft/JsonWriter.hpp"
+
+#include "botcraft/Network/PacketLogger.hpp"
+
+namespace Botcraft
+{
+    // Value used in the sampling arrays for packets without specific rate
+    static const unsigned int use_default_sampling = std::numeric_limits<unsigned int>::max();
+
+    // Append an integer in little endian, independently of the host byte order
+    template<typename T>
+    static void AppendLittleEndian(const T value, std::vector<char>& buffer)
+    {
+        const unsigned long long bits = static_cast<unsigned long long>(static_cast<typename std::make_unsigned<T>::type>(value));
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static void AppendString(const char* s, std::vector<char>& buffer)
+    {
+        buffer.insert(buffer.end(), s, s + std::strlen(s));
+    }
+
+    static void AppendString(const std::string& s, std::vector<char>& buffer)
+    {
+        buffer.insert(buffer.end(), s.begin(), s.end());
+    }
+
+    PacketLogger::PacketLogger(const std::string& path, const PacketLogFormat format_, const bool include_payload_)
+    {
+        format = format_;
+        include_payload = include_payload_;
+
+        file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error trying to open packet log file at " + path);
+        }
+
+        for (int i = 0; i < max_sampled_id; ++i)
+        {
+            incoming_sampling[i] = use_default_sampling;
+            outgoing_sampling[i] = use_default_sampling;
+            incoming_counters[i] = 0;
+            outgoing_counters[i] = 0;
+        }
+        incoming_other_counter = 0;
+        outgoing_other_counter = 0;
+        default_sampling = 1;
+        num_dropped = 0;
+
+        pending_buffer.reserve(flush_threshold);
+        writing_buffer.reserve(flush_threshold);
+
+        start_time = std::chrono::steady_clock::now();
+        running = true;
+        writer_thread = std::thread(&PacketLogger::WriterLoop, this);
+    }
+
+    PacketLogger::~PacketLogger()
+    {
+        {
+            std::lock_guard<std::mutex> lock(buffer_mutex);
+            running = false;
+        }
+        buffer_condition.notify_all();
+
+        if (writer_thread.joinable())
+        {
+            writer_thread.join();
+        }
+
+        file.close();
+    }
+
+    void PacketLogger::SetSamplingRate(const int packet_id, const bool outgoing, const unsigned int one_every)
+    {
+        if (packet_id < 0 || packet_id >= max_sampled_id)
+        {
+            std::cerr << "Warning, can't set a sampling rate for packet id " << packet_id << std::endl;
+            return;
+        }
+
+        if (outgoing)
+        {
+            outgoing_sampling[packet_id] = one_every;
+        }
+        else
+        {
+            incoming_sampling[packet_id] = one_every;
+        }
+    }
+
+    void PacketLogger::SetDefaultSamplingRate(const unsigned int one_every)
+    {
+        default_sampling = one_every;
+    }
+
+    const unsigned long long PacketLogger::GetNumDroppedRecords() const
+    {
+        return num_dropped;
+    }
+
+    void PacketLogger::Log(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+        const bool outgoing, const ProtocolCraft::ConnectionState state)
+    {
+        if (!ShouldLog(msg.GetId(), outgoing, state))
+        {
+            return;
+        }
+
+        const unsigned long long timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+        bool should_notify = false;
+        {
+            std::lock_guard<std::mutex> lock(buffer_mutex);
+            if (pending_buffer.size() > max_pending_size)
+            {
+                num_dropped++;
+                return;
+            }
+
+            switch (format)
+            {
+            case PacketLogFormat::JsonLines:
+                WriteJsonRecord(msg, raw_packet, outgoing, state, timestamp);
+                break;
+            case PacketLogFormat::Binary:
+                WriteBinaryRecord(msg, raw_packet, outgoing, state, timestamp);
+                break;
+            default:
+                break;
+            }
+            should_notify = pending_buffer.size() > flush_threshold;
+        }
+
+        if (should_notify)
+        {
+            buffer_condition.notify_all();
+        }
+    }
+
+    const bool PacketLogger::ShouldLog(const int packet_id, const bool outgoing, const ProtocolCraft::ConnectionState state)
+    {
+        // Packets outside of play state are rare, always log them
+        if (state != ProtocolCraft::ConnectionState::Play)
+        {
+            return true;
+        }
+
+        // Packets without specific rate use the default one
+        const bool has_specific_rate = packet_id >= 0 && packet_id < max_sampled_id;
+        unsigned int one_every = use_default_sampling;
+        if (has_specific_rate)
+        {
+            one_every = outgoing ? outgoing_sampling[packet_id].load(std::memory_order_relaxed) : incoming_sampling[packet_id].load(std::memory_order_relaxed);
+        }
+        if (one_every == use_default_sampling)
+        {
+            one_every = default_sampling.load(std::memory_order_relaxed);
+        }
+
+        if (one_every == 0)
+        {
+            return false;
+        }
+        if (one_every == 1)
+        {
+            return true;
+        }
+
+        std::atomic<unsigned int>& counter = has_specific_rate ?
+            (outgoing ? outgoing_counters[packet_id] : incoming_counters[packet_id]) :
+            (outgoing ? outgoing_other_counter : incoming_other_counter);
+        return counter.fetch_add(1, std::memory_order_relaxed) % one_every == 0;
+    }
+
+    void PacketLogger::WriteJsonRecord(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+        const bool outgoing, const ProtocolCraft::ConnectionState state, const unsigned long long timestamp)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+
+        AppendString("{\"t\":", pending_buffer);
+        AppendString(std::to_string(timestamp), pending_buffer);
+        AppendString(outgoing ? ",\"dir\":\"out\",\"state\":" : ",\"dir\":\"in\",\"state\":", pending_buffer);
+        AppendString(std::to_string(static_cast<int>(state)), pending_buffer);
+        AppendString(",\"id\":", pending_buffer);
+        AppendString(std::to_string(msg.GetId()), pending_buffer);
+        // Message names are plain identifiers, no need to escape them
+        AppendString(",\"name\":\"", pending_buffer);
+        AppendString(msg.GetName(), pending_buffer);
+        AppendString("\",\"size\":", pending_buffer);
+        AppendString(std::to_string(raw_packet.size()), pending_buffer);
+
+        // Decoded packet fields, streamed directly into the buffer
+        AppendString(",\"data\":", pending_buffer);
+        const size_t data_start = pending_buffer.size();
+        try
+        {
+            ProtocolCraft::JsonWriter writer(pending_buffer);
+            msg.WriteJson(writer);
+        }
+        catch (const std::exception&)
+        {
+            // Don't leave a partial object in the buffer
+            pending_buffer.resize(data_start);
+            AppendString("null", pending_buffer);
+        }
+
+        if (include_payload)
+        {
+            AppendString(",\"raw\":\"", pending_buffer);
+            const size_t current_size = pending_buffer.size();
+            pending_buffer.resize(current_size + 2 * raw_packet.size());
+            char* data = pending_buffer.data() + current_size;
+            for (size_t i = 0; i < raw_packet.size(); ++i)
+            {
+                data[2 * i] = hex_digits[raw_packet[i] >> 4];
+                data[2 * i + 1] = hex_digits[raw_packet[i] & 0x0F];
+            }
+            pending_buffer.push_back('"');
+        }
+        AppendString("}\n", pending_buffer);
+    }
+
+    void PacketLogger::WriteBinaryRecord(const ProtocolCraft::Message& msg, const std::vector<unsigned char>& raw_packet,
+        const bool outgoing, const ProtocolCraft::ConnectionState state, const unsigned long long timestamp)
+    {
+        const unsigned int payload_size = include_payload ? static_cast<unsigned int>(raw_packet.size()) : 0;
+
+        AppendLittleEndian<unsigned long long>(timestamp, pending_buffer);
+        AppendLittleEndian<unsigned char>(outgoing ? 1 : 0, pending_buffer);
+        AppendLittleEndian<char>(static_cast<char>(state), pending_buffer);
+        AppendLittleEndian<int>(msg.GetId(), pending_buffer);
+        AppendLittleEndian<unsigned int>(payload_size, pending_buffer);
+        pending_buffer.insert(pending_buffer.end(), raw_packet.begin(), raw_packet.begin() + payload_size);
+    }
+
+    void PacketLogger::WriterLoop()
+    {
+        while (true)
+        {
+            bool should_stop = false;
+            {
+                std::unique_lock<std::mutex> lock(buffer_mutex);
+                // Wake up at least every second to flush what's been logged so far
+                buffer_condition.wait_for(lock, std::chrono::seconds(1), [this]() { return !running || pending_buffer.size() > flush_threshold; });
+                should_stop = !running;
+                std::swap(pending_buffer, writing_buffer);
+            }
+
+            if (!writing_buffer.empty())
+            {
+                file.write(writing_buffer.data(), writing_buffer.size());
+                file.flush();
+                writing_buffer.clear();
+            }
+
+            if (should_stop)
+            {
+                break;
+            }
+        }
+    }
+} // Botcraft
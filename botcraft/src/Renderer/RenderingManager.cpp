@@ -143,7 +143,7 @@ namespace Botcraft
                     Position raycasted_normal;
                     std::shared_ptr<Blockstate> raycasted_blockstate;
                     {
-                        std::lock_guard<std::mutex> world_guard(world->GetMutex());
+                        std::shared_lock<std::shared_mutex> world_guard(world->GetMutex());
                         raycasted_blockstate =
                             world->Raycast(Vector3<double>(world_renderer->GetCamera()->GetPosition().x, world_renderer->GetCamera()->GetPosition().y, world_renderer->GetCamera()->GetPosition().z),
                             Vector3<double>(world_renderer->GetCamera()->GetFront().x, world_renderer->GetCamera()->GetFront().y, world_renderer->GetCamera()->GetFront().z),
@@ -542,6 +542,7 @@ namespace Botcraft
                     mutex_updating.unlock();
 
                     std::shared_ptr<const Botcraft::Chunk> chunk;
+                    std::array<std::shared_ptr<const Botcraft::Chunk>, 4> neighbours;
                     // Get the new values in the world
                     world->GetMutex().lock();
                     bool has_chunk_been_modified = world->HasChunkBeenModified(pos.x, pos.z);
@@ -549,12 +550,19 @@ namespace Botcraft
                     {
                         chunk = world->GetChunkCopy(pos.x, pos.z);
                         world->ResetChunkModificationState(pos.x, pos.z);
+                        if (chunk)
+                        {
+                            neighbours[0] = world->GetChunkCopy(pos.x, pos.z - 1);
+                            neighbours[1] = world->GetChunkCopy(pos.x - 1, pos.z);
+                            neighbours[2] = world->GetChunkCopy(pos.x + 1, pos.z);
+                            neighbours[3] = world->GetChunkCopy(pos.x, pos.z + 1);
+                        }
                     }
                     world->GetMutex().unlock();
 
                     if (has_chunk_been_modified)
                     {
-                        world_renderer->UpdateChunk(pos.x, pos.z, chunk);
+                        world_renderer->UpdateChunk(pos.x, pos.z, chunk, neighbours);
                     }
 
                     // If we left the game, we don't need to process 
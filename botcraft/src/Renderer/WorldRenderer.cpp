@@ -143,7 +143,8 @@ namespace Botcraft
             }
         }
 
-        void WorldRenderer::UpdateChunk(const int x_, const int z_, const std::shared_ptr<const Botcraft::Chunk> chunk)
+        void WorldRenderer::UpdateChunk(const int x_, const int z_, const std::shared_ptr<const Botcraft::Chunk> chunk,
+            const std::array<std::shared_ptr<const Botcraft::Chunk>, 4>& neighbours)
         {
             // Remove any previous version of this chunk
             {
@@ -183,7 +184,28 @@ namespace Botcraft
                             Position(-1, 0, 0), Position(1, 0, 0), Position(0, 0, 1), Position(0, 1, 0) });
 
             std::vector<std::shared_ptr<Blockstate> > neighbour_blockstates(6);
-            std::vector<unsigned char> neighbour_model_ids(6);
+
+            // Blocks outside of this chunk are read from the neighbour chunks
+            auto GetNeighbourBlock = [&](const Position& p) -> const Block*
+            {
+                if (p.x < 0)
+                {
+                    return neighbours[1] ? neighbours[1]->GetBlock(Position(p.x + CHUNK_WIDTH, p.y, p.z)) : nullptr;
+                }
+                if (p.x >= CHUNK_WIDTH)
+                {
+                    return neighbours[2] ? neighbours[2]->GetBlock(Position(p.x - CHUNK_WIDTH, p.y, p.z)) : nullptr;
+                }
+                if (p.z < 0)
+                {
+                    return neighbours[0] ? neighbours[0]->GetBlock(Position(p.x, p.y, p.z + CHUNK_WIDTH)) : nullptr;
+                }
+                if (p.z >= CHUNK_WIDTH)
+                {
+                    return neighbours[3] ? neighbours[3]->GetBlock(Position(p.x, p.y, p.z - CHUNK_WIDTH)) : nullptr;
+                }
+                return chunk->GetBlock(p);
+            };
 
             Position pos;
             for (int y = chunk->GetMinY(); y < chunk->GetHeight() + chunk->GetMinY(); ++y)
@@ -207,16 +229,14 @@ namespace Botcraft
                         // Else check its neighbours to find which face to draw
                         for (int i = 0; i < 6; ++i)
                         {
-                            const Block* neighbour_block = chunk->GetBlock(pos + neighbour_positions[i]);
+                            const Block* neighbour_block = GetNeighbourBlock(pos + neighbour_positions[i]);
                             if (neighbour_block == nullptr)
                             {
                                 neighbour_blockstates[i] = nullptr;
-                                neighbour_model_ids[i] = 0;
                             }
                             else
                             {
                                 neighbour_blockstates[i] = neighbour_block->GetBlockstate();
-                                neighbour_model_ids[i] = neighbour_block->GetModelId();
                             }
                         }
 
@@ -238,7 +258,8 @@ namespace Botcraft
                         }
 
                         //Add all faces of the current state
-                        const std::vector<FaceDescriptor>& current_faces = this_block->GetBlockstate()->GetModel(this_block->GetModelId()).GetFaces();
+                        const Position world_pos(pos.x + CHUNK_WIDTH * x_, pos.y, pos.z + CHUNK_WIDTH * z_);
+                        const std::vector<FaceDescriptor>& current_faces = this_block->GetBlockstate()->GetModel(this_block->GetBlockstate()->GetModelId(world_pos)).GetFaces();
 #if PROTOCOL_VERSION < 552
                         const std::shared_ptr<Biome> current_biome = AssetsManager_.GetBiome(chunk->GetBiome(x, z));
 #else
@@ -256,7 +277,7 @@ namespace Botcraft
                                     neighbour_blockstates[(int)current_faces[i].cullface_direction]->GetName() != this_block->GetBlockstate()->GetName())
                                 )
                             {
-                                AddFace(pos.x + CHUNK_WIDTH * x_, pos.y, pos.z + CHUNK_WIDTH * z_,
+                                AddFace(world_pos.x, world_pos.y, world_pos.z,
                                     current_faces[i].face, current_faces[i].texture_names,
                                     GetColorModifier(pos.y, current_biome, this_block->GetBlockstate(),
                                         current_faces[i].use_tintindexes));
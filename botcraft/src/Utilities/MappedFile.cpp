@@ -0,0 +1,153 @@
+#include "botcraft/Utilities/MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Botcraft
+{
+    MappedFile::MappedFile()
+    {
+        data = nullptr;
+        size = 0;
+        is_open = false;
+#ifdef _WIN32
+        file_handle = INVALID_HANDLE_VALUE;
+        mapping_handle = nullptr;
+#else
+        file_descriptor = -1;
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    const bool MappedFile::Open(const std::string& path)
+    {
+        Close();
+
+#ifdef _WIN32
+        // Other handles can still write the file while it's mapped
+        file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle, &file_size))
+        {
+            Close();
+            return false;
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+        is_open = true;
+
+        // Empty files can't be mapped
+        if (size == 0)
+        {
+            return true;
+        }
+
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        data = static_cast<const unsigned char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+        file_descriptor = open(path.c_str(), O_RDONLY);
+        if (file_descriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(file_descriptor, &file_stat) != 0)
+        {
+            Close();
+            return false;
+        }
+        size = static_cast<size_t>(file_stat.st_size);
+        is_open = true;
+
+        // Empty files can't be mapped
+        if (size == 0)
+        {
+            return true;
+        }
+
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+        data = mapping == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(mapping);
+#endif
+
+        if (data == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mapping_handle != nullptr)
+        {
+            CloseHandle(mapping_handle);
+            mapping_handle = nullptr;
+        }
+        if (file_handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_handle);
+            file_handle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data != nullptr)
+        {
+            munmap(const_cast<unsigned char*>(data), size);
+        }
+        if (file_descriptor >= 0)
+        {
+            close(file_descriptor);
+            file_descriptor = -1;
+        }
+#endif
+        data = nullptr;
+        size = 0;
+        is_open = false;
+    }
+
+    const bool MappedFile::IsOpen() const
+    {
+        return is_open;
+    }
+
+    const unsigned char* MappedFile::GetData() const
+    {
+        return data;
+    }
+
+    const size_t MappedFile::GetSize() const
+    {
+        return size;
+    }
+} // Botcraft
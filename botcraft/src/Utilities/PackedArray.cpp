@@ -0,0 +1,140 @@
+#include "botcraft/Utilities/PackedArray.hpp"
+
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Botcraft
+{
+    // Unpack entries [start, num_entries[
+    static void UnpackSpanning(const std::vector<unsigned long long int>& data, const unsigned char bits_per_entry,
+        const int start, const int num_entries, unsigned int* output)
+    {
+        const unsigned long long int mask = (1ULL << bits_per_entry) - 1;
+        size_t bit_offset = static_cast<size_t>(start) * bits_per_entry;
+        for (int i = start; i < num_entries; ++i)
+        {
+            const size_t long_index = bit_offset >> 6;
+            const int shift = bit_offset & 63;
+            unsigned long long int value = data[long_index] >> shift;
+            if (shift + bits_per_entry > 64)
+            {
+                value |= data[long_index + 1] << (64 - shift);
+            }
+            output[i] = static_cast<unsigned int>(value & mask);
+            bit_offset += bits_per_entry;
+        }
+    }
+
+    // Unpack the values of longs [start, end[
+    static void UnpackNonSpanning(const std::vector<unsigned long long int>& data, const unsigned char bits_per_entry,
+        const size_t start, const size_t end, const int num_entries, unsigned int* output)
+    {
+        const unsigned long long int mask = (1ULL << bits_per_entry) - 1;
+        const int entries_per_long = 64 / bits_per_entry;
+        int index = static_cast<int>(start) * entries_per_long;
+        for (size_t i = start; i < end; ++i)
+        {
+            unsigned long long int value = data[i];
+            for (int j = 0; j < entries_per_long && index < num_entries; ++j)
+            {
+                output[index] = static_cast<unsigned int>(value & mask);
+                value >>= bits_per_entry;
+                index++;
+            }
+        }
+    }
+
+#if defined(__AVX2__)
+    // Store the low 32 bits of the four 64 bits lanes of v
+    static inline void StoreLow32(const __m256i v, unsigned int* output)
+    {
+        const __m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm256_castsi256_si128(packed));
+    }
+#endif
+
+    const bool UnpackLongArray(const std::vector<unsigned long long int>& data, const unsigned char bits_per_entry,
+        const bool spanning, const int num_entries, unsigned int* output)
+    {
+        if (bits_per_entry == 0 || bits_per_entry > 32 || num_entries <= 0)
+        {
+            return num_entries <= 0;
+        }
+
+        if (spanning)
+        {
+            if (data.size() < (static_cast<size_t>(num_entries) * bits_per_entry + 63) / 64)
+            {
+                return false;
+            }
+
+            int start = 0;
+#if defined(__AVX2__)
+            // Four entries at a time: gather the two longs
+            // each entry can be in, shift them and merge them
+            const __m256i mask = _mm256_set1_epi64x((1LL << bits_per_entry) - 1);
+            const __m256i sixty_three = _mm256_set1_epi64x(63);
+            const __m256i sixty_four = _mm256_set1_epi64x(64);
+            const __m256i one = _mm256_set1_epi64x(1);
+            const __m256i offset_step = _mm256_set1_epi64x(4LL * bits_per_entry);
+            __m256i bit_offsets = _mm256_setr_epi64x(0, bits_per_entry, 2LL * bits_per_entry, 3LL * bits_per_entry);
+            const long long int* base = reinterpret_cast<const long long int*>(data.data());
+
+            // The next long of the last entry must exist
+            for (; start + 4 <= num_entries && ((static_cast<size_t>(start + 3) * bits_per_entry) >> 6) + 1 < data.size(); start += 4)
+            {
+                const __m256i long_indices = _mm256_srli_epi64(bit_offsets, 6);
+                const __m256i shifts = _mm256_and_si256(bit_offsets, sixty_three);
+                const __m256i low = _mm256_i64gather_epi64(base, long_indices, 8);
+                const __m256i high = _mm256_i64gather_epi64(base, _mm256_add_epi64(long_indices, one), 8);
+                // Shifting by 64 gives 0, so entries that don't span take nothing from high
+                const __m256i values = _mm256_and_si256(_mm256_or_si256(_mm256_srlv_epi64(low, shifts),
+                    _mm256_sllv_epi64(high, _mm256_sub_epi64(sixty_four, shifts))), mask);
+                StoreLow32(values, output + start);
+                bit_offsets = _mm256_add_epi64(bit_offsets, offset_step);
+            }
+#endif
+            UnpackSpanning(data, bits_per_entry, start, num_entries, output);
+        }
+        else
+        {
+            const int entries_per_long = 64 / bits_per_entry;
+            const size_t num_longs = (static_cast<size_t>(num_entries) + entries_per_long - 1) / entries_per_long;
+            if (data.size() < num_longs)
+            {
+                return false;
+            }
+
+            size_t start = 0;
+#if defined(__AVX2__)
+            // Each long is broadcasted in four lanes shifted by
+            // 0, 1, 2 and 3 entries, then by 4, 5, 6 and 7 entries...
+            // If entries_per_long is not a multiple of 4, the last values
+            // are garbage, but they are overwritten by the next long ones.
+            // The last longs are done without SIMD so nothing is written
+            // after the end of output
+            const __m256i mask = _mm256_set1_epi64x((1LL << bits_per_entry) - 1);
+            const __m256i first_shifts = _mm256_setr_epi64x(0, bits_per_entry, 2LL * bits_per_entry, 3LL * bits_per_entry);
+            const __m256i shift_step = _mm256_set1_epi64x(4LL * bits_per_entry);
+            const int entries_per_iteration = (entries_per_long + 3) & ~3;
+            for (; start + 1 < num_longs && start * entries_per_long + entries_per_iteration <= static_cast<size_t>(num_entries); ++start)
+            {
+                const __m256i value = _mm256_set1_epi64x(static_cast<long long int>(data[start]));
+                __m256i shifts = first_shifts;
+                unsigned int* current_output = output + start * entries_per_long;
+                for (int j = 0; j < entries_per_long; j += 4)
+                {
+                    StoreLow32(_mm256_and_si256(_mm256_srlv_epi64(value, shifts), mask), current_output + j);
+                    shifts = _mm256_add_epi64(shifts, shift_step);
+                }
+            }
+#endif
+            UnpackNonSpanning(data, bits_per_entry, start, num_longs, num_entries, output);
+        }
+
+        return true;
+    }
+} // Botcraft
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <type_traits>
+
+#include <nlohmann/json.hpp>
+
+namespace ProtocolCraft
+{
+    class NetworkType;
+
+    // Write json text directly into a char buffer, one
+    // field at a time, without building a nlohmann::json
+    // tree first. Commas are added automatically between
+    // the elements of the current object/array.
+    class JsonWriter
+    {
+    public:
+        JsonWriter(std::vector<char>& output_);
+
+        void StartObject();
+        void EndObject();
+        void StartArray();
+        void EndArray();
+        void Key(const char* key);
+
+        void Value(const bool b);
+        void Value(const char* s);
+        void Value(const std::string& s);
+        void Value(const NetworkType& t);
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type Value(const T i)
+        {
+            Separator();
+            WriteRaw(std::to_string(i));
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type Value(const T f)
+        {
+            Separator();
+            WriteFloat(static_cast<double>(f), std::is_same<T, float>::value);
+        }
+
+        template<typename T>
+        void Value(const std::vector<T>& v)
+        {
+            StartArray();
+            for (size_t i = 0; i < v.size(); ++i)
+            {
+                Value(v[i]);
+            }
+            EndArray();
+        }
+
+        template<typename T, size_t N>
+        void Value(const std::array<T, N>& a)
+        {
+            StartArray();
+            for (size_t i = 0; i < N; ++i)
+            {
+                Value(a[i]);
+            }
+            EndArray();
+        }
+
+        // Write an already built json value
+        void JsonValue(const nlohmann::json& j);
+
+        template<typename T>
+        void Field(const char* key, const T& value)
+        {
+            Key(key);
+            Value(value);
+        }
+
+    private:
+        void Separator();
+        void WriteRaw(const char* s);
+        void WriteRaw(const std::string& s);
+        void WriteFloat(const double f, const bool single_precision);
+
+    private:
+        std::vector<char>& output;
+        // For each open object/array, whether an element
+        // has already been written in it
+        std::vector<bool> has_element;
+        bool after_key;
+    };
+} // ProtocolCraft
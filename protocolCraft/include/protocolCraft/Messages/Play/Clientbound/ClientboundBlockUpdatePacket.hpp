@@ -84,6 +84,16 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("pos", pos);
+            writer.Field("blockstate", blockstate);
+
+            writer.EndObject();
+        }
+
     private:
         NetworkPosition pos;
         int blockstate;
@@ -70,6 +70,15 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("id_", id_);
+
+            writer.EndObject();
+        }
+
     private:
         long long int id_;
     };
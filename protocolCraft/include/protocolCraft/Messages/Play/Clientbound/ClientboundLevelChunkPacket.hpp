@@ -294,6 +294,37 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("z", z);
+#if PROTOCOL_VERSION > 730 && PROTOCOL_VERSION < 745
+            writer.Field("ignore_old_data", ignore_old_data);
+#endif
+#if PROTOCOL_VERSION < 755
+            writer.Field("available_sections", available_sections);
+#else
+            writer.Field("available_sections", available_sections);
+#endif
+#if PROTOCOL_VERSION > 442
+            writer.Field("heightmaps", heightmaps);
+#endif
+#if PROTOCOL_VERSION > 551
+            writer.Field("biomes", "Vector of " + std::to_string(biomes.size()) + " int");
+#endif
+            writer.Field("buffer", "Vector of " + std::to_string(buffer.size()) + " unsigned char");
+
+            writer.Field("block_entities_tags", block_entities_tags);
+
+#if PROTOCOL_VERSION < 755
+            writer.Field("full_chunk", full_chunk);
+#endif
+
+            writer.EndObject();
+        }
+
     private:
         int x;
         int z;
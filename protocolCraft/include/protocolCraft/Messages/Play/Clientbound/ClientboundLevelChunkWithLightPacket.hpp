@@ -105,6 +105,19 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("z", z);
+
+            writer.Field("chunk_data", chunk_data);
+            writer.Field("light_data", light_data);
+
+            writer.EndObject();
+        }
+
     private:
         int x;
         int z;
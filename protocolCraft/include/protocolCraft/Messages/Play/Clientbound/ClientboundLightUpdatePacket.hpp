@@ -368,6 +368,31 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("z", z);
+#if PROTOCOL_VERSION < 757
+#if PROTOCOL_VERSION > 722
+            writer.Field("trust_edges", trust_edges);
+#endif
+            writer.Field("sky_Y_mask", sky_Y_mask);
+            writer.Field("block_Y_mask", block_Y_mask);
+            writer.Field("empty_sky_Y_mask", empty_sky_Y_mask);
+            writer.Field("empty_block_Y_mask", empty_block_Y_mask);
+
+            writer.Field("sky_updates", sky_updates);
+
+            writer.Field("block_updates", block_updates);
+#else
+            writer.Field("light_data", light_data);
+#endif
+
+            writer.EndObject();
+        }
+
     private:
         int x;
         int z;
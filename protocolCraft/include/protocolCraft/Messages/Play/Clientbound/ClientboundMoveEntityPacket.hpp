@@ -67,6 +67,15 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("entity_id", entity_id);
+
+            writer.EndObject();
+        }
+
     private:
         int entity_id;
     };
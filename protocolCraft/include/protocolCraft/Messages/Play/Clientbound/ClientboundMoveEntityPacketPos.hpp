@@ -122,6 +122,19 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("entity_id", entity_id);
+            writer.Field("x_a", x_a);
+            writer.Field("y_a", y_a);
+            writer.Field("z_a", z_a);
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         int entity_id;
         short x_a;
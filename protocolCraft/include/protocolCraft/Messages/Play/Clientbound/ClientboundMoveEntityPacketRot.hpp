@@ -109,6 +109,18 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("entity_id", entity_id);
+            writer.Field("yRot", yRot);
+            writer.Field("xRot", xRot);
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         int entity_id;
         unsigned char yRot;
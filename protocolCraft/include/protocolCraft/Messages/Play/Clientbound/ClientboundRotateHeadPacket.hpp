@@ -85,6 +85,16 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("entity_id", entity_id);
+            writer.Field("y_head_rot", y_head_rot);
+
+            writer.EndObject();
+        }
+
     private:
         int entity_id;
         Angle y_head_rot;
@@ -203,6 +203,26 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+#if PROTOCOL_VERSION < 739
+            writer.Field("chunk_x", chunk_x);
+            writer.Field("chunk_z", chunk_z);
+            writer.Field("record_count", record_count);
+
+            writer.Field("records", records);
+#else
+            writer.Field("section_pos", section_pos);
+            writer.Field("suppress_light_updates", suppress_light_updates);
+            writer.Field("positions", positions);
+            writer.Field("states", states);
+#endif
+
+            writer.EndObject();
+        }
+
     private:
 #if PROTOCOL_VERSION < 739
         int chunk_x;
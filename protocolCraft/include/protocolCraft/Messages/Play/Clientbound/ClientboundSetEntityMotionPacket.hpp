@@ -111,6 +111,18 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("id_", id_);
+            writer.Field("x_a", x_a);
+            writer.Field("y_a", y_a);
+            writer.Field("z_a", z_a);
+
+            writer.EndObject();
+        }
+
     private:
         int id_;
         short x_a;
@@ -83,6 +83,16 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("game_time", game_time);
+            writer.Field("day_time", day_time);
+
+            writer.EndObject();
+        }
+
     private:
         long long int game_time;
         long long int day_time;
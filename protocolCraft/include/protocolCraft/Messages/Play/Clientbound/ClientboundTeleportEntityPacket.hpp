@@ -148,6 +148,21 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("id_", id_);
+            writer.Field("x", x);
+            writer.Field("y", y);
+            writer.Field("z", z);
+            writer.Field("yRot", yRot);
+            writer.Field("xRot", xRot);
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         int id_;
         double x;
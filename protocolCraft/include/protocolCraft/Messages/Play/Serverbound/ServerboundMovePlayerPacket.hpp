@@ -69,6 +69,15 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         bool on_ground;
 
@@ -111,6 +111,18 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("y", y);
+            writer.Field("z", z);
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         double x;
         double y;
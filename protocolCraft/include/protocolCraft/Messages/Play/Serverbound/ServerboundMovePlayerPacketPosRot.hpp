@@ -135,6 +135,20 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("y", y);
+            writer.Field("z", z);
+            writer.Field("yRot", yRot);
+            writer.Field("xRot", xRot);
+            writer.Field("on_ground", on_ground);
+
+            writer.EndObject();
+        }
+
     private:
         double x;
         double y;
@@ -5,6 +5,7 @@
 #include <nlohmann/json.hpp>
 
 #include "protocolCraft/BinaryReadWrite.hpp"
+#include "protocolCraft/JsonWriter.hpp"
 
 namespace ProtocolCraft
 {
@@ -31,9 +32,22 @@ namespace ProtocolCraft
             return SerializeImpl();
         }
 
+        // Same content as Serialize, but streamed to writer
+        virtual void WriteJson(JsonWriter &writer) const
+        {
+            return WriteJsonImpl(writer);
+        }
+
     protected:
         virtual void ReadImpl(ReadIterator &iter, size_t &length) = 0;
         virtual void WriteImpl(WriteContainer &container) const = 0;
         virtual const nlohmann::json SerializeImpl() const = 0;
+
+        // Default implementation goes through the json tree,
+        // frequent types override it to write their fields directly
+        virtual void WriteJsonImpl(JsonWriter &writer) const
+        {
+            writer.JsonValue(SerializeImpl());
+        }
     };
 } // ProtocolCraft
\ No newline at end of file
@@ -84,6 +84,18 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("packed_XZ", packed_XZ);
+            writer.Field("y", y);
+            writer.Field("type", type);
+            writer.Field("tag", tag);
+
+            writer.EndObject();
+        }
+
     private:
         unsigned char packed_XZ;
         short y;
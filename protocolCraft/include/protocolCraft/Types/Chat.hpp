@@ -58,10 +58,26 @@ namespace ProtocolCraft
             WriteData<std::string>(raw_text, container);
         }
 
+        // Flatten a json chat component into plain text.
+        // The raw string is read in a single pass, without
+        // building any intermediate json object.
+        // For chat.type.text messages, sender is stored in from
+        // and only the message content is returned
         const std::string ParseChat(const std::string &json);
 
         virtual const nlohmann::json SerializeImpl() const override;
 
+    private:
+        // Append the flattened text of the component starting at pos to output
+        void FlattenComponent(const std::string& json, size_t& pos, std::string& output, const bool top_level);
+        void FlattenObject(const std::string& json, size_t& pos, std::string& output, const bool top_level);
+        // Read a json string starting at pos, and append its
+        // unescaped content to output if not nullptr
+        void ReadString(const std::string& json, size_t& pos, std::string* output) const;
+        void SkipValue(const std::string& json, size_t& pos) const;
+        void SkipWhitespaces(const std::string& json, size_t& pos) const;
+        void Expect(const std::string& json, size_t& pos, const char c) const;
+
     private:
         std::string text;
         std::string from;
@@ -91,6 +91,19 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("heightmaps", heightmaps);
+
+            writer.Field("buffer", "Vector of " + std::to_string(buffer.size()) + " unsigned char");
+
+            writer.Field("block_entities_data", block_entities_data);
+
+            writer.EndObject();
+        }
+
     private:
         NBT heightmaps;
         std::vector<unsigned char> buffer;
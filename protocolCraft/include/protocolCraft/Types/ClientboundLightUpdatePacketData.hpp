@@ -198,6 +198,24 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("trust_edges", trust_edges);
+
+            writer.Field("sky_Y_mask", sky_Y_mask);
+            writer.Field("block_Y_mask", block_Y_mask);
+            writer.Field("empty_sky_Y_mask", empty_sky_Y_mask);
+            writer.Field("empty_block_Y_mask", empty_block_Y_mask);
+
+            writer.Field("sky_updates", sky_updates);
+
+            writer.Field("block_updates", block_updates);
+
+            writer.EndObject();
+        }
+
     private:
         std::vector<unsigned long long int> sky_Y_mask;
         std::vector<unsigned long long int> block_Y_mask;
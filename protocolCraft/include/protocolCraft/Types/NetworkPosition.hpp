@@ -103,6 +103,17 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("x", x);
+            writer.Field("y", y);
+            writer.Field("z", z);
+
+            writer.EndObject();
+        }
+
     private:
         int x;
         int y;
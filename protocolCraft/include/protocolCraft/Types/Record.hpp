@@ -72,6 +72,17 @@ namespace ProtocolCraft
             return output;
         }
 
+        virtual void WriteJsonImpl(JsonWriter &writer) const override
+        {
+            writer.StartObject();
+
+            writer.Field("horizontal_position", horizontal_position);
+            writer.Field("y_coordinate", y_coordinate);
+            writer.Field("block_id", block_id);
+
+            writer.EndObject();
+        }
+
     private:
         unsigned char horizontal_position;
         unsigned char y_coordinate;
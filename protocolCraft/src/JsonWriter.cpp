@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+
+#include "protocolCraft/JsonWriter.hpp"
+#include "protocolCraft/NetworkType.hpp"
+
+namespace ProtocolCraft
+{
+    JsonWriter::JsonWriter(std::vector<char>& output_) : output(output_)
+    {
+        after_key = false;
+    }
+
+    void JsonWriter::StartObject()
+    {
+        Separator();
+        output.push_back('{');
+        has_element.push_back(false);
+    }
+
+    void JsonWriter::EndObject()
+    {
+        output.push_back('}');
+        has_element.pop_back();
+    }
+
+    void JsonWriter::StartArray()
+    {
+        Separator();
+        output.push_back('[');
+        has_element.push_back(false);
+    }
+
+    void JsonWriter::EndArray()
+    {
+        output.push_back(']');
+        has_element.pop_back();
+    }
+
+    void JsonWriter::Key(const char* key)
+    {
+        // Keys are field names, no need to escape them
+        Separator();
+        output.push_back('"');
+        WriteRaw(key);
+        output.push_back('"');
+        output.push_back(':');
+        after_key = true;
+    }
+
+    void JsonWriter::Value(const bool b)
+    {
+        Separator();
+        WriteRaw(b ? "true" : "false");
+    }
+
+    void JsonWriter::Value(const char* s)
+    {
+        Value(std::string(s));
+    }
+
+    void JsonWriter::Value(const std::string& s)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+
+        Separator();
+        output.push_back('"');
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            switch (c)
+            {
+            case '"':
+                WriteRaw("\\\"");
+                break;
+            case '\\':
+                WriteRaw("\\\\");
+                break;
+            case '\n':
+                WriteRaw("\\n");
+                break;
+            case '\r':
+                WriteRaw("\\r");
+                break;
+            case '\t':
+                WriteRaw("\\t");
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    WriteRaw("\\u00");
+                    output.push_back(hex_digits[c >> 4]);
+                    output.push_back(hex_digits[c & 0x0F]);
+                }
+                else
+                {
+                    output.push_back(static_cast<char>(c));
+                }
+                break;
+            }
+        }
+        output.push_back('"');
+    }
+
+    void JsonWriter::Value(const NetworkType& t)
+    {
+        t.WriteJson(*this);
+    }
+
+    void JsonWriter::JsonValue(const nlohmann::json& j)
+    {
+        Separator();
+        WriteRaw(j.dump());
+    }
+
+    void JsonWriter::Separator()
+    {
+        if (after_key)
+        {
+            after_key = false;
+            return;
+        }
+
+        if (!has_element.empty())
+        {
+            if (has_element.back())
+            {
+                output.push_back(',');
+            }
+            has_element.back() = true;
+        }
+    }
+
+    void JsonWriter::WriteRaw(const char* s)
+    {
+        output.insert(output.end(), s, s + std::strlen(s));
+    }
+
+    void JsonWriter::WriteRaw(const std::string& s)
+    {
+        output.insert(output.end(), s.begin(), s.end());
+    }
+
+    void JsonWriter::WriteFloat(const double f, const bool single_precision)
+    {
+        // Same as nlohmann::json, NaN and infinity are written as null
+        if (!std::isfinite(f))
+        {
+            WriteRaw("null");
+            return;
+        }
+
+        // Use the shortest representation that reads back to the same value
+        const int min_precision = single_precision ? std::numeric_limits<float>::digits10 : std::numeric_limits<double>::digits10;
+        const int max_precision = single_precision ? std::numeric_limits<float>::max_digits10 : std::numeric_limits<double>::max_digits10;
+        char buffer[32];
+        int size = 0;
+        for (int precision = min_precision; precision <= max_precision; ++precision)
+        {
+            size = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, f);
+            const double read_back = std::strtod(buffer, nullptr);
+            if (single_precision ? static_cast<float>(read_back) == static_cast<float>(f) : read_back == f)
+            {
+                break;
+            }
+        }
+        output.insert(output.end(), buffer, buffer + size);
+    }
+} // ProtocolCraft
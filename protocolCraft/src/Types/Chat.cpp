@@ -1,4 +1,7 @@
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
 #include <nlohmann/json.hpp>
 
 #include "protocolCraft/Types/Chat.hpp"
@@ -7,67 +10,425 @@ namespace ProtocolCraft
 {
     const std::string Chat::ParseChat(const std::string &json)
     {
-        nlohmann::json v;
+        std::string output;
+        // Flattened text is never longer than the json itself,
+        // so this is the only allocation needed for the result
+        output.reserve(json.size());
+
         try
         {
-            v = nlohmann::json::parse(json);
+            size_t pos = 0;
+            SkipWhitespaces(json, pos);
+            FlattenComponent(json, pos, output, true);
+            SkipWhitespaces(json, pos);
+            if (pos != json.size())
+            {
+                throw std::runtime_error("unexpected character at position " + std::to_string(pos));
+            }
         }
-        catch (const nlohmann::json::exception& e)
+        catch (const std::exception& e)
         {
             std::cerr << "Error parsing chat message: " << e.what() << std::endl;
+            from = "";
             return "";
         }
 
-        if (v.is_object())
+        return output;
+    }
+
+    void Chat::FlattenComponent(const std::string& json, size_t& pos, std::string& output, const bool top_level)
+    {
+        if (pos >= json.size())
+        {
+            throw std::runtime_error("unexpected end of input");
+        }
+
+        switch (json[pos])
         {
-            if (v.contains("translate") && v["translate"].is_string())
+        case '"':
+            ReadString(json, pos, &output);
+            break;
+        case '{':
+            FlattenObject(json, pos, output, top_level);
+            break;
+        case '[':
+            // First element is the parent component, others are its
+            // siblings, so the text is just the concatenation of all elements
+            Expect(json, pos, '[');
+            SkipWhitespaces(json, pos);
+            if (pos < json.size() && json[pos] == ']')
+            {
+                pos++;
+                break;
+            }
+            while (true)
             {
-                std::string output;
+                FlattenComponent(json, pos, output, false);
+                SkipWhitespaces(json, pos);
+                if (pos < json.size() && json[pos] == ',')
+                {
+                    pos++;
+                    SkipWhitespaces(json, pos);
+                    continue;
+                }
+                Expect(json, pos, ']');
+                break;
+            }
+            break;
+        default:
+            // Numbers, booleans and null don't produce any text
+            SkipValue(json, pos);
+            break;
+        }
+    }
 
-                // Only deal with other player commands
-                if (v["translate"] == "chat.type.text")
+    void Chat::FlattenObject(const std::string& json, size_t& pos, std::string& output, const bool top_level)
+    {
+        // Fields can appear in any order (vanilla writes extra before text),
+        // but the output must be text, then translation arguments, then extra.
+        // Each value is flattened at the end of the output and then rotated
+        // in place if it needs to be moved before what's already there
+        const size_t start = output.size();
+        size_t text_end = start;
+        size_t translate_end = start;
+
+        bool is_chat_text = false;
+        size_t with_start = start;
+        size_t first_arg_size = 0;
+        size_t num_args = 0;
+
+        Expect(json, pos, '{');
+        SkipWhitespaces(json, pos);
+        if (pos < json.size() && json[pos] == '}')
+        {
+            pos++;
+            return;
+        }
+
+        while (true)
+        {
+            const size_t key_start = pos;
+            ReadString(json, pos, nullptr);
+            // Raw key, without the quotes. The keys we're interested in
+            // don't contain any escaped character so no need to unescape them
+            const char* key = json.data() + key_start + 1;
+            const size_t key_size = pos - key_start - 2;
+
+            SkipWhitespaces(json, pos);
+            Expect(json, pos, ':');
+            SkipWhitespaces(json, pos);
+
+            if (key_size == 4 && std::strncmp(key, "text", 4) == 0)
+            {
+                const size_t value_start = output.size();
+                FlattenComponent(json, pos, output, false);
+                const size_t value_size = output.size() - value_start;
+                std::rotate(output.begin() + text_end, output.begin() + value_start, output.end());
+                text_end += value_size;
+                translate_end += value_size;
+                with_start += value_size;
+            }
+            else if (key_size == 9 && std::strncmp(key, "translate", 9) == 0)
+            {
+                const size_t value_start = pos;
+                ReadString(json, pos, nullptr);
+                is_chat_text = pos - value_start == 16 && json.compare(value_start + 1, 14, "chat.type.text") == 0;
+            }
+            else if (key_size == 4 && std::strncmp(key, "with", 4) == 0)
+            {
+                const size_t value_start = output.size();
+                Expect(json, pos, '[');
+                SkipWhitespaces(json, pos);
+                if (pos < json.size() && json[pos] == ']')
+                {
+                    pos++;
+                }
+                else
                 {
-                    if (v.contains("with") && v["with"].is_array())
+                    while (true)
                     {
-                        for (auto& s : v["with"])
+                        // We don't have the translation strings,
+                        // so arguments are just separated with spaces
+                        if (num_args > 0)
                         {
-                            if (s.is_object() && s.contains("text") && s.at("text").is_string())
-                            {
-                                from += s["text"].get<std::string>();
-                            }
-                            else if (s.is_string())
-                            {
-                                output += s.get<std::string>();
-                            }
+                            output.push_back(' ');
                         }
+                        const size_t arg_start = output.size();
+                        FlattenComponent(json, pos, output, false);
+                        if (num_args == 0)
+                        {
+                            first_arg_size = output.size() - arg_start;
+                        }
+                        num_args++;
+
+                        SkipWhitespaces(json, pos);
+                        if (pos < json.size() && json[pos] == ',')
+                        {
+                            pos++;
+                            SkipWhitespaces(json, pos);
+                            continue;
+                        }
+                        Expect(json, pos, ']');
+                        break;
                     }
                 }
-                return output;
+                const size_t value_size = output.size() - value_start;
+                std::rotate(output.begin() + translate_end, output.begin() + value_start, output.end());
+                with_start = translate_end;
+                translate_end += value_size;
+            }
+            else if (key_size == 5 && std::strncmp(key, "extra", 5) == 0)
+            {
+                // Extra always goes last, just append it
+                FlattenComponent(json, pos, output, false);
+            }
+            else
+            {
+                SkipValue(json, pos);
+            }
+
+            SkipWhitespaces(json, pos);
+            if (pos < json.size() && json[pos] == ',')
+            {
+                pos++;
+                SkipWhitespaces(json, pos);
+                continue;
             }
+            Expect(json, pos, '}');
+            break;
         }
 
-        if (v.is_null())
+        // Player chat message, first argument is the sender
+        // and the following ones the content of the message
+        if (top_level && is_chat_text && num_args > 0)
         {
-            return "";
+            from.assign(output, with_start, first_arg_size);
+            output.erase(with_start, first_arg_size + (num_args > 1 ? 1 : 0));
         }
+    }
+
+    void Chat::ReadString(const std::string& json, size_t& pos, std::string* output) const
+    {
+        Expect(json, pos, '"');
 
-        if (v.is_string())
+        while (true)
         {
-            return v.get<std::string>();
+            const size_t chunk_start = pos;
+            while (pos < json.size() && json[pos] != '"' && json[pos] != '\\')
+            {
+                pos++;
+            }
+            if (pos >= json.size())
+            {
+                throw std::runtime_error("unterminated string");
+            }
+            if (output != nullptr)
+            {
+                output->append(json, chunk_start, pos - chunk_start);
+            }
+            if (json[pos] == '"')
+            {
+                pos++;
+                return;
+            }
+
+            // Escaped character
+            pos++;
+            if (pos >= json.size())
+            {
+                throw std::runtime_error("unterminated string");
+            }
+            const char c = json[pos++];
+            if (c != 'u')
+            {
+                if (output == nullptr)
+                {
+                    continue;
+                }
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    output->push_back(c);
+                    break;
+                case 'b':
+                    output->push_back('\b');
+                    break;
+                case 'f':
+                    output->push_back('\f');
+                    break;
+                case 'n':
+                    output->push_back('\n');
+                    break;
+                case 'r':
+                    output->push_back('\r');
+                    break;
+                case 't':
+                    output->push_back('\t');
+                    break;
+                default:
+                    throw std::runtime_error("invalid escape sequence at position " + std::to_string(pos - 1));
+                }
+                continue;
+            }
+
+            // \uXXXX, with an optional low surrogate for code points > 0xFFFF
+            unsigned int code_point = 0;
+            for (int n = 0; n < 2; ++n)
+            {
+                if (pos + 4 > json.size())
+                {
+                    throw std::runtime_error("invalid unicode escape sequence");
+                }
+                unsigned int code_unit = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const char h = json[pos++];
+                    code_unit <<= 4;
+                    if (h >= '0' && h <= '9')
+                    {
+                        code_unit |= h - '0';
+                    }
+                    else if (h >= 'a' && h <= 'f')
+                    {
+                        code_unit |= h - 'a' + 10;
+                    }
+                    else if (h >= 'A' && h <= 'F')
+                    {
+                        code_unit |= h - 'A' + 10;
+                    }
+                    else
+                    {
+                        throw std::runtime_error("invalid unicode escape sequence");
+                    }
+                }
+
+                if (n == 0)
+                {
+                    code_point = code_unit;
+                    // Not a high surrogate, or not followed by a low one
+                    if (code_unit < 0xD800 || code_unit > 0xDBFF ||
+                        pos + 2 > json.size() || json[pos] != '\\' || json[pos + 1] != 'u')
+                    {
+                        break;
+                    }
+                    pos += 2;
+                }
+                else
+                {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (code_unit - 0xDC00);
+                }
+            }
+
+            if (output == nullptr)
+            {
+                continue;
+            }
+
+            // UTF-8 encoding
+            if (code_point < 0x80)
+            {
+                output->push_back(static_cast<char>(code_point));
+            }
+            else if (code_point < 0x800)
+            {
+                output->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+                output->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else if (code_point < 0x10000)
+            {
+                output->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+                output->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                output->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else
+            {
+                output->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+                output->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+                output->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                output->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
         }
+    }
 
-        if (v.is_array())
+    void Chat::SkipValue(const std::string& json, size_t& pos) const
+    {
+        if (pos >= json.size())
         {
-            std::string output;
+            throw std::runtime_error("unexpected end of input");
+        }
 
-            for (auto& s : v)
+        switch (json[pos])
+        {
+        case '"':
+            ReadString(json, pos, nullptr);
+            break;
+        case '{':
+        case '[':
+        {
+            const char closing = json[pos] == '{' ? '}' : ']';
+            pos++;
+            SkipWhitespaces(json, pos);
+            if (pos < json.size() && json[pos] == closing)
+            {
+                pos++;
+                break;
+            }
+            while (true)
             {
-                output += ParseChat(s.dump());
+                if (closing == '}')
+                {
+                    ReadString(json, pos, nullptr);
+                    SkipWhitespaces(json, pos);
+                    Expect(json, pos, ':');
+                    SkipWhitespaces(json, pos);
+                }
+                SkipValue(json, pos);
+                SkipWhitespaces(json, pos);
+                if (pos < json.size() && json[pos] == ',')
+                {
+                    pos++;
+                    SkipWhitespaces(json, pos);
+                    continue;
+                }
+                Expect(json, pos, closing);
+                break;
             }
-            return output;
+            break;
         }
+        default:
+        {
+            // Number, true, false or null
+            const size_t value_start = pos;
+            while (pos < json.size() && std::strchr(",}] \t\n\r", json[pos]) == nullptr)
+            {
+                pos++;
+            }
+            if (pos == value_start)
+            {
+                throw std::runtime_error("unexpected character at position " + std::to_string(pos));
+            }
+            break;
+        }
+        }
+    }
 
-        return "";
+    void Chat::SkipWhitespaces(const std::string& json, size_t& pos) const
+    {
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r'))
+        {
+            pos++;
+        }
+    }
+
+    void Chat::Expect(const std::string& json, size_t& pos, const char c) const
+    {
+        if (pos >= json.size() || json[pos] != c)
+        {
+            throw std::runtime_error(std::string("expected '") + c + "' at position " + std::to_string(pos));
+        }
+        pos++;
     }
 
     const nlohmann::json Chat::SerializeImpl() const
@@ -79,4 +440,4 @@ namespace ProtocolCraft
 
         return value;
     }
-}
\ No newline at end of file
+}